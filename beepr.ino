@@ -1,33 +1,48 @@
 #include <Arduino.h>
 #include "beepr_config.h"
+#include "beepr_log.h"
+#include "beepr_alert.h"
 #include "beepr_display.h"
 #include "beepr_buttons.h"
 #include "beepr_notifs.h"
 #include "beepr_ble.h"
+#include "beepr_console.h"
+#include "beepr_events.h"
+#include "beepr_flightrec.h"
+#include "beepr_power.h"
+#include "beepr_profiler.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 BLENotifications notifications;
-static TaskHandle_t buttonTaskHandle = nullptr;
 static TaskHandle_t bleTaskHandle = nullptr;
 
+#if BEEPR_HAS_BUTTONS
+static TaskHandle_t buttonTaskHandle = nullptr;
+
 static void buttonTask(void *param)
 {
     (void)param;
+    BeeprButtons::attachTask(xTaskGetCurrentTaskHandle());
     for (;;)
     {
-        BeeprButtons::update();
-        vTaskDelay(pdMS_TO_TICKS(5));
+        // Poll only while debouncing; otherwise sleep until an interrupt.
+        bool settling = BeeprButtons::update();
+        ulTaskNotifyTake(pdTRUE, settling ? pdMS_TO_TICKS(5) : portMAX_DELAY);
     }
 }
+#endif
 
 static void bleTask(void *param)
 {
     (void)param;
+    BeeprBle::attachTask(xTaskGetCurrentTaskHandle());
     for (;;)
     {
-        BeeprBle::update();
-        vTaskDelay(pdMS_TO_TICKS(5));
+        // Sleep until the nearest deadline (keep-alive, advertising step,
+        // expiry, age on screen) unless new work wakes the task first.
+        uint32_t waitMs = BeeprBle::update();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
     }
 }
 
@@ -36,30 +51,64 @@ void setup()
     pinMode(PAIRING_PIN, INPUT_PULLUP);
     bool pairingMode = (digitalRead(PAIRING_PIN) == LOW);
 
+#if BEEPR_HAS_CONSOLE
+    Serial.setRxBufferSize(SERIAL_RX_BUFFER);
+#endif
     Serial.begin(115200);
     delay(200);
+    BeeprFlightRec::begin();
 
+    BeeprNotifs::begin();
     BeeprDisplay::begin();
+    BeeprAlert::begin();
+#if BEEPR_HAS_BUTTONS
     BeeprButtons::begin();
+#endif
 
     if (pairingMode)
     {
-        Serial.println("PAIRING MODE");
+        BEEPR_LOGI("PAIRING MODE\n");
         BeeprDisplay::showStatus("PAIRING", "MODE");
     }
     else
     {
-        Serial.println("NORMAL MODE");
+        BEEPR_LOGI("NORMAL MODE\n");
         BeeprDisplay::showStatus("NORMAL", "MODE");
     }
 
     BeeprBle::begin(pairingMode);
+    BeeprPower::begin();
+    // setup() and loop() run on the same task.
+    BeeprPower::attachTask(xTaskGetCurrentTaskHandle());
+#if BEEPR_HAS_CONSOLE
+    BeeprConsole::attachTask(xTaskGetCurrentTaskHandle());
+#endif
 
-    xTaskCreatePinnedToCore(buttonTask, "beepr_buttons", 4096, nullptr, 3, &buttonTaskHandle, 1);
-    xTaskCreatePinnedToCore(bleTask, "beepr_ble", 6144, nullptr, 2, &bleTaskHandle, 0);
+#if BEEPR_HAS_BUTTONS
+    xTaskCreatePinnedToCore(buttonTask, "beepr_buttons", BUTTON_TASK_STACK, nullptr, 3, &buttonTaskHandle, 1);
+    BeeprProfiler::watchTask(buttonTaskHandle, BUTTON_TASK_STACK);
+#endif
+    xTaskCreatePinnedToCore(bleTask, "beepr_ble", BLE_TASK_STACK, nullptr, 2, &bleTaskHandle, 0);
+    BeeprProfiler::watchTask(bleTaskHandle, BLE_TASK_STACK);
+    BeeprProfiler::watchTask(xTaskGetCurrentTaskHandle(), getArduinoLoopTaskStackSize());
+
+    if (STORM_TEST_EVENTS > 0)
+    {
+        BeeprEvents::injectStorm(STORM_TEST_EVENTS);
+    }
 }
 
 void loop()
 {
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // Sleep until the nearest deadline (profiler sample, display idle,
+    // console hold) unless UART input or a display wake-up comes first, so
+    // an idle loop never keeps the CPU out of light sleep.
+#if BEEPR_HAS_CONSOLE
+    BeeprConsole::update();
+#endif
+    uint32_t waitMs = BeeprProfiler::update();
+    uint32_t powerMs = BeeprPower::update();
+    waitMs = powerMs < waitMs ? powerMs : waitMs;
+    BeeprFlightRec::update();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 }
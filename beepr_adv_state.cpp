@@ -0,0 +1,115 @@
+#include "beepr_adv_state.h"
+
+static void enterStep(AdvState &state, uint8_t step, uint32_t nowMs)
+{
+    if (state.advertising)
+    {
+        state.stepMs[state.step] += nowMs - state.stepSinceMs;
+    }
+    state.step = step;
+    state.stepSinceMs = nowMs;
+}
+
+void BeeprAdvState::reset(AdvState &state)
+{
+    state = AdvState();
+}
+
+AdvAction BeeprAdvState::start(AdvState &state, const AdvStep *steps, uint8_t stepCount, uint32_t nowMs)
+{
+    if (!steps || stepCount == 0)
+    {
+        return AdvActionNone;
+    }
+    enterStep(state, 0, nowMs);
+    state.steps = steps;
+    state.stepCount = stepCount < ADV_MAX_STEPS ? stepCount : ADV_MAX_STEPS;
+    state.advertising = true;
+    state.advertisingSinceMs = nowMs;
+    return AdvActionRestart;
+}
+
+void BeeprAdvState::onConnected(AdvState &state, uint32_t nowMs)
+{
+    if (!state.advertising)
+    {
+        return;
+    }
+    enterStep(state, state.step, nowMs);
+    state.advertising = false;
+
+    uint32_t ms = nowMs - state.advertisingSinceMs;
+    state.connects++;
+    state.connectsAtStep[state.step]++;
+    state.lastConnectMs = ms;
+    state.totalConnectMs += ms;
+    if (state.connects == 1 || ms < state.minConnectMs)
+    {
+        state.minConnectMs = ms;
+    }
+    if (ms > state.maxConnectMs)
+    {
+        state.maxConnectMs = ms;
+    }
+}
+
+AdvAction BeeprAdvState::onActivity(AdvState &state, uint32_t nowMs)
+{
+    // Someone is at the device, so the phone is probably close: go fast again.
+    if (!state.advertising || state.step == 0)
+    {
+        return AdvActionNone;
+    }
+    state.activityResets++;
+    enterStep(state, 0, nowMs);
+    return AdvActionRestart;
+}
+
+AdvAction BeeprAdvState::onTick(AdvState &state, uint32_t nowMs)
+{
+    if (!state.advertising || state.step + 1 >= state.stepCount)
+    {
+        return AdvActionNone;
+    }
+    uint32_t durationMs = state.steps[state.step].durationMs;
+    if (durationMs == 0 || (nowMs - state.stepSinceMs) < durationMs)
+    {
+        return AdvActionNone;
+    }
+    enterStep(state, state.step + 1, nowMs);
+    return AdvActionRestart;
+}
+
+uint32_t BeeprAdvState::msUntilTick(const AdvState &state, uint32_t nowMs)
+{
+    if (!state.advertising || state.step + 1 >= state.stepCount)
+    {
+        return ADV_NO_DEADLINE;
+    }
+    uint32_t durationMs = state.steps[state.step].durationMs;
+    if (durationMs == 0)
+    {
+        return ADV_NO_DEADLINE;
+    }
+    uint32_t elapsedMs = nowMs - state.stepSinceMs;
+    return elapsedMs < durationMs ? durationMs - elapsedMs : 0;
+}
+
+uint16_t BeeprAdvState::intervalUnits(const AdvState &state)
+{
+    return state.steps ? state.steps[state.step].intervalUnits : 0;
+}
+
+uint32_t BeeprAdvState::stepResidency(const AdvState &state, uint8_t step, uint32_t nowMs)
+{
+    if (step >= ADV_MAX_STEPS)
+    {
+        return 0;
+    }
+    uint32_t ms = state.stepMs[step];
+    if (state.advertising && step == state.step)
+    {
+        ms += nowMs - state.stepSinceMs;
+    }
+    return ms;
+}
@@ -0,0 +1,59 @@
+#ifndef BEEPR_ADV_STATE_H
+#define BEEPR_ADV_STATE_H
+
+#include <stdint.h>
+
+// Advertising schedule state machine. Pure logic on caller-supplied
+// timestamps with no Arduino or IDF dependencies, so it builds and runs
+// unchanged on a host.
+
+// One phase of a schedule. Intervals are in controller units of 0.625 ms.
+struct AdvStep
+{
+    uint16_t intervalUnits;
+    uint32_t durationMs; // 0 holds this step until connected.
+};
+
+static const uint8_t ADV_MAX_STEPS = 6;
+static const uint32_t ADV_NO_DEADLINE = 0xFFFFFFFFUL;
+
+enum AdvAction : uint8_t
+{
+    AdvActionNone = 0,
+    AdvActionRestart = 1 // (Re)start advertising at intervalUnits().
+};
+
+struct AdvState
+{
+    const AdvStep *steps;
+    uint8_t stepCount;
+    uint8_t step;
+    bool advertising;
+    uint32_t advertisingSinceMs;
+    uint32_t stepSinceMs;
+
+    // Time to reconnect: from the start of advertising to the connection.
+    uint32_t connects;
+    uint32_t lastConnectMs;
+    uint32_t minConnectMs;
+    uint32_t maxConnectMs;
+    uint64_t totalConnectMs;
+    uint32_t connectsAtStep[ADV_MAX_STEPS];
+    uint32_t stepMs[ADV_MAX_STEPS];   // Residency, excluding the current step.
+    uint32_t activityResets;
+};
+
+namespace BeeprAdvState
+{
+    void reset(AdvState &state);
+    AdvAction start(AdvState &state, const AdvStep *steps, uint8_t stepCount, uint32_t nowMs);
+    void onConnected(AdvState &state, uint32_t nowMs);
+    AdvAction onActivity(AdvState &state, uint32_t nowMs);
+    AdvAction onTick(AdvState &state, uint32_t nowMs);
+    // Time until onTick() would step down, ADV_NO_DEADLINE if it never will.
+    uint32_t msUntilTick(const AdvState &state, uint32_t nowMs);
+    uint16_t intervalUnits(const AdvState &state);
+    uint32_t stepResidency(const AdvState &state, uint8_t step, uint32_t nowMs);
+}
+
+#endif
@@ -0,0 +1,411 @@
+#include "beepr_alert.h"
+#include "beepr_config.h"
+#include "beepr_log.h"
+
+#if BEEPR_HAS_ALERTS
+
+#include "beepr_alert_seq.h"
+
+#include "beepr_profiler.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "driver/ledc.h"
+#include "hal/ledc_ll.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+struct AlertPattern
+{
+    const char *name;
+    uint8_t priority; // Higher preempts lower.
+    const uint8_t *code;
+};
+
+static const uint8_t chirpCode[] = {
+    ALERT_TONE(2700), ALERT_LED(255), ALERT_WAIT(60), ALERT_TONE(0), ALERT_WAIT(140), ALERT_END};
+static const uint8_t blinkCode[] = {ALERT_LED(255), ALERT_WAIT(100), ALERT_LED(0), ALERT_WAIT(100), ALERT_LOOP(1),
+                                    ALERT_END};
+static const uint8_t doubleChirpCode[] = {
+    ALERT_TONE(2700), ALERT_LED(255), ALERT_WAIT(50), ALERT_TONE(0), ALERT_LED(0), ALERT_WAIT(70), ALERT_LOOP(1),
+    ALERT_END};
+static const uint8_t emailCode[] = {
+    ALERT_TONE(2000), ALERT_LED(255), ALERT_WAIT(120), ALERT_TONE(0), ALERT_WAIT(200), ALERT_END};
+static const uint8_t scheduleCode[] = {
+    ALERT_LED(255), ALERT_TONE(1500), ALERT_WAIT(80), ALERT_TONE(2000), ALERT_WAIT(80), ALERT_TONE(2500),
+    ALERT_WAIT(120), ALERT_END};
+static const uint8_t missedCode[] = {
+    ALERT_TONE(2700), ALERT_LED(255), ALERT_VIB(255), ALERT_WAIT(150), ALERT_TONE(0), ALERT_LED(0), ALERT_VIB(0),
+    ALERT_WAIT(100), ALERT_LOOP(1), ALERT_END};
+static const uint8_t callCode[] = {
+    ALERT_VIB(255), ALERT_LED(255), ALERT_TONE(2700), ALERT_WAIT(400), ALERT_TONE(0), ALERT_WAIT(200),
+    ALERT_TONE(2700), ALERT_WAIT(400), ALERT_TONE(0), ALERT_VIB(0), ALERT_LED(0), ALERT_WAIT(1000), ALERT_LOOP(4),
+    ALERT_END};
+static const uint8_t alarmCode[] = {
+    ALERT_TONE(3000), ALERT_LED(255), ALERT_WAIT(1000), ALERT_TONE(0), ALERT_LED(0), ALERT_WAIT(500), ALERT_LOOP(2),
+    ALERT_END};
+
+// Index 0 is BeeprAlert::PATTERN_NONE.
+static const AlertPattern patterns[] = {
+    {"none", 0, nullptr},
+    {"chirp", 0, chirpCode},
+    {"blink", 0, blinkCode},
+    {"double", 1, doubleChirpCode},
+    {"email", 1, emailCode},
+    {"schedule", 1, scheduleCode},
+    {"missed", 2, missedCode},
+    {"call", 3, callCode},
+    {"alarm", 3, alarmCode},
+};
+static const uint8_t PATTERN_COUNT = sizeof(patterns) / sizeof(patterns[0]);
+
+// Indexed by NotificationCategory.
+static const uint8_t categoryPatterns[] = {
+    1, // Other
+    7, // IncomingCall
+    6, // MissedCall
+    6, // Voicemail
+    1, // Social
+    5, // Schedule
+    4, // Email
+    2, // News
+    1, // HealthAndFitness
+    4, // BusinessAndFinance
+    1, // Location
+    2, // Entertainment
+};
+
+struct AppPattern
+{
+    const char *app;
+    uint8_t pattern;
+};
+
+static const AppPattern appPatterns[] = {
+    {"Messages", 3},
+    {"Clock", 8},
+};
+
+static const ledc_mode_t LEDC_MODE = LEDC_LOW_SPEED_MODE;
+static const ledc_timer_t TONE_TIMER = LEDC_TIMER_2;
+static const ledc_timer_t PWM_TIMER = LEDC_TIMER_3;
+static const ledc_channel_t TONE_CHANNEL = LEDC_CHANNEL_5;
+static const ledc_channel_t LED_CHANNEL = LEDC_CHANNEL_6;
+static const ledc_channel_t VIB_CHANNEL = LEDC_CHANNEL_7;
+static const uint32_t TONE_DUTY = 128; // 50% at TONE_DUTY_BITS.
+static const uint8_t TONE_DUTY_BITS = 8;
+// The tone timer runs from APB, held at its maximum while a pattern plays.
+static const uint32_t TONE_CLOCK_HZ = 80000000UL;
+// LEDC clock divider: 10 integer and 8 fractional bits, at least 1.0.
+static const uint32_t TONE_DIVIDER_MIN = 1UL << 8;
+static const uint32_t TONE_DIVIDER_MAX = (1UL << 18) - 1;
+static const uint8_t TONE_TABLE_SIZE = 8;
+static const uint8_t HW_TIMER_NUM = 1;
+
+// Divider per tone used by the patterns, computed once by begin(): the tick
+// interrupt writes it straight into the timer register instead of calling
+// ledc_set_freq(), which is not safe in an interrupt.
+struct ToneDivider
+{
+    uint16_t hz;
+    uint32_t divider;
+};
+
+static portMUX_TYPE alertMux = portMUX_INITIALIZER_UNLOCKED;
+static AlertSeqState seq;
+static AlertOutputs applied;
+static hw_timer_t *alertTimer = nullptr;
+static bool timerRunning = false;
+static ToneDivider toneDividers[TONE_TABLE_SIZE];
+static uint8_t toneCount = 0;
+// Stops the tick timer once a pattern has ended; the interrupt only asks.
+static TaskHandle_t stopTaskHandle = nullptr;
+#if CONFIG_PM_ENABLE
+// LEDC and the tick timer run from APB, which stops in light sleep and
+// would change the tone under frequency scaling.
+static esp_pm_lock_handle_t pmLock = nullptr;
+#endif
+
+static void addTone(uint16_t hz)
+{
+    for (uint8_t i = 0; i < toneCount; i++)
+    {
+        if (toneDividers[i].hz == hz)
+        {
+            return;
+        }
+    }
+    uint32_t divider = (uint32_t)(((uint64_t)TONE_CLOCK_HZ << 8) / ((uint64_t)hz << TONE_DUTY_BITS));
+    if (toneCount >= TONE_TABLE_SIZE || divider < TONE_DIVIDER_MIN || divider > TONE_DIVIDER_MAX)
+    {
+        BEEPR_LOGW("Alert: tone %u Hz not playable, it stays silent\n", (unsigned)hz);
+        return;
+    }
+    toneDividers[toneCount].hz = hz;
+    toneDividers[toneCount].divider = divider;
+    toneCount++;
+}
+
+static void buildToneTable()
+{
+    for (uint8_t p = 1; p < PATTERN_COUNT; p++)
+    {
+        const uint8_t *code = patterns[p].code;
+        for (size_t pc = 0; code[pc] != AlertOpEnd; pc += 2)
+        {
+            if (code[pc] == AlertOpTone && code[pc + 1] != 0)
+            {
+                addTone((uint16_t)(code[pc + 1] * 20));
+            }
+        }
+    }
+}
+
+static uint32_t toneDivider(uint16_t hz)
+{
+    for (uint8_t i = 0; i < toneCount; i++)
+    {
+        if (toneDividers[i].hz == hz)
+        {
+            return toneDividers[i].divider;
+        }
+    }
+    return 0;
+}
+
+static void setupChannel(int pin, ledc_channel_t channel, ledc_timer_t timer)
+{
+    if (pin < 0)
+    {
+        return;
+    }
+    ledc_channel_config_t cfg = {};
+    cfg.gpio_num = pin;
+    cfg.speed_mode = LEDC_MODE;
+    cfg.channel = channel;
+    cfg.intr_type = LEDC_INTR_DISABLE;
+    cfg.timer_sel = timer;
+    cfg.duty = 0;
+    ledc_channel_config(&cfg);
+}
+
+static void setDuty(int pin, ledc_channel_t channel, uint32_t duty)
+{
+    if (pin >= 0)
+    {
+        ledc_set_duty(LEDC_MODE, channel, duty);
+        ledc_update_duty(LEDC_MODE, channel);
+    }
+}
+
+// Called with alertMux held. The duty calls only take the driver's
+// spinlock; the tone is a register write of a precomputed divider.
+static void writeOutputsLocked(const AlertOutputs &out)
+{
+    if (out.toneHz != applied.toneHz)
+    {
+        uint32_t divider = out.toneHz > 0 ? toneDivider(out.toneHz) : 0;
+        if (divider && ALERT_BUZZER_PIN >= 0)
+        {
+            ledc_ll_set_clock_divider(LEDC_LL_GET_HW(), LEDC_MODE, TONE_TIMER, divider);
+            ledc_ll_ls_timer_update(LEDC_LL_GET_HW(), LEDC_MODE, TONE_TIMER);
+        }
+        setDuty(ALERT_BUZZER_PIN, TONE_CHANNEL, divider ? TONE_DUTY : 0);
+    }
+    if (out.led != applied.led)
+    {
+        setDuty(ALERT_LED_PIN, LED_CHANNEL, out.led);
+    }
+    if (out.vib != applied.vib)
+    {
+        setDuty(ALERT_VIB_PIN, VIB_CHANNEL, out.vib);
+    }
+    applied = out;
+}
+
+// A regular (non-IRAM) timer interrupt: while flash is busy, e.g. during a
+// filter NVS write, it is deferred rather than run from cache.
+static void onAlertTick()
+{
+    BaseType_t woken = pdFALSE;
+    portENTER_CRITICAL_ISR(&alertMux);
+    bool playing = BeeprAlertSeq::tick(seq);
+    writeOutputsLocked(seq.out);
+    if (!playing && timerRunning && stopTaskHandle)
+    {
+        vTaskNotifyGiveFromISR(stopTaskHandle, &woken);
+    }
+    portEXIT_CRITICAL_ISR(&alertMux);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Idle ticks between the end of a pattern and this task running are
+// harmless: the outputs are already off. A pattern started meanwhile keeps
+// the timer.
+static void alertStopTask(void *)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&alertMux);
+        if (!seq.playing && timerRunning)
+        {
+            timerStop(alertTimer);
+            timerRunning = false;
+#if CONFIG_PM_ENABLE
+            if (pmLock)
+            {
+                esp_pm_lock_release(pmLock);
+            }
+#endif
+        }
+        portEXIT_CRITICAL(&alertMux);
+    }
+}
+
+void BeeprAlert::begin()
+{
+    BeeprAlertSeq::reset(seq);
+    buildToneTable();
+
+    ledc_timer_config_t toneTimer = {};
+    toneTimer.speed_mode = LEDC_MODE;
+    toneTimer.duty_resolution = LEDC_TIMER_8_BIT;
+    toneTimer.timer_num = TONE_TIMER;
+    toneTimer.freq_hz = 2000;
+    toneTimer.clk_cfg = LEDC_USE_APB_CLK;
+    ledc_timer_config(&toneTimer);
+
+    ledc_timer_config_t pwmTimer = toneTimer;
+    pwmTimer.timer_num = PWM_TIMER;
+    pwmTimer.freq_hz = 5000;
+    pwmTimer.clk_cfg = LEDC_AUTO_CLK;
+    ledc_timer_config(&pwmTimer);
+
+    setupChannel(ALERT_BUZZER_PIN, TONE_CHANNEL, TONE_TIMER);
+    setupChannel(ALERT_LED_PIN, LED_CHANNEL, PWM_TIMER);
+    setupChannel(ALERT_VIB_PIN, VIB_CHANNEL, PWM_TIMER);
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "beepr_alert", &pmLock);
+#endif
+
+    // 1 MHz timebase with an ALERT_TICK_MS auto-reload alarm, left stopped
+    // until something plays.
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    alertTimer = timerBegin(1000000);
+    if (alertTimer)
+    {
+        timerAttachInterrupt(alertTimer, onAlertTick);
+        timerAlarm(alertTimer, ALERT_TICK_MS * 1000, true, 0);
+    }
+#else
+    alertTimer = timerBegin(HW_TIMER_NUM, 80, true);
+    if (alertTimer)
+    {
+        timerAttachInterrupt(alertTimer, onAlertTick, true);
+        timerAlarmWrite(alertTimer, ALERT_TICK_MS * 1000, true);
+        timerAlarmEnable(alertTimer);
+    }
+#endif
+    if (!alertTimer)
+    {
+        BEEPR_LOGE("Alert: no hardware timer, alerts disabled\n");
+        return;
+    }
+    timerStop(alertTimer);
+    xTaskCreatePinnedToCore(alertStopTask, "beepr_alert", ALERT_TASK_STACK, nullptr, 1, &stopTaskHandle, 1);
+    BeeprProfiler::watchTask(stopTaskHandle, ALERT_TASK_STACK);
+    BEEPR_LOGI("Alert: buzzer %d, LED %d, vibration %d\n", ALERT_BUZZER_PIN, ALERT_LED_PIN, ALERT_VIB_PIN);
+}
+
+uint8_t BeeprAlert::patternFor(uint8_t category, const char *app)
+{
+    if (app)
+    {
+        for (size_t i = 0; i < sizeof(appPatterns) / sizeof(appPatterns[0]); i++)
+        {
+            if (strcmp(app, appPatterns[i].app) == 0)
+            {
+                return appPatterns[i].pattern;
+            }
+        }
+    }
+    return category < sizeof(categoryPatterns) ? categoryPatterns[category] : PATTERN_NONE;
+}
+
+void BeeprAlert::play(uint8_t pattern)
+{
+    if (pattern == PATTERN_NONE || pattern >= PATTERN_COUNT || !alertTimer)
+    {
+        return;
+    }
+    const AlertPattern &p = patterns[pattern];
+
+    portENTER_CRITICAL(&alertMux);
+    AlertRequestResult result = BeeprAlertSeq::request(seq, p.code, p.priority, millis(), ALERT_COALESCE_MS);
+    if ((result == AlertStarted || result == AlertPreempted) && !timerRunning)
+    {
+#if CONFIG_PM_ENABLE
+        if (pmLock)
+        {
+            esp_pm_lock_acquire(pmLock);
+        }
+#endif
+        timerRunning = true;
+        timerWrite(alertTimer, 0);
+        timerStart(alertTimer);
+    }
+    portEXIT_CRITICAL(&alertMux);
+}
+
+uint8_t BeeprAlert::patternCount()
+{
+    return PATTERN_COUNT;
+}
+
+void BeeprAlert::printStats()
+{
+    portENTER_CRITICAL(&alertMux);
+    AlertSeqState s = seq;
+    portEXIT_CRITICAL(&alertMux);
+
+    Serial.printf("Alert: started=%lu preempted=%lu coalesced=%lu ignored=%lu, %s\n", (unsigned long)s.started,
+                  (unsigned long)s.preempted, (unsigned long)s.coalesced, (unsigned long)s.ignored,
+                  s.playing ? "playing" : "idle");
+    for (uint8_t i = 1; i < PATTERN_COUNT; i++)
+    {
+        Serial.printf("  %u %-9s priority %u\n", (unsigned)i, patterns[i].name, (unsigned)patterns[i].priority);
+    }
+}
+
+#else // No alert outputs fitted.
+
+void BeeprAlert::begin()
+{
+}
+
+uint8_t BeeprAlert::patternFor(uint8_t category, const char *app)
+{
+    (void)category;
+    (void)app;
+    return PATTERN_NONE;
+}
+
+void BeeprAlert::play(uint8_t pattern)
+{
+    (void)pattern;
+}
+
+uint8_t BeeprAlert::patternCount()
+{
+    return 0;
+}
+
+void BeeprAlert::printStats()
+{
+    Serial.println("Alert: not built in");
+}
+
+#endif
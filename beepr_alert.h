@@ -0,0 +1,22 @@
+#ifndef BEEPR_ALERT_H
+#define BEEPR_ALERT_H
+
+#include <Arduino.h>
+
+// Buzzer, LED and vibration alerts for new notifications. Patterns are
+// bytecode (beepr_alert_seq.h) played by a hardware timer interrupt into LEDC
+// channels, so playback never runs on, blocks or wakes any task.
+namespace BeeprAlert
+{
+    static const uint8_t PATTERN_NONE = 0;
+
+    void begin();
+    // Pattern for a notification, by app name first and then category.
+    uint8_t patternFor(uint8_t category, const char *app);
+    // Never blocks; see BeeprAlertSeq::request() for preemption and coalescing.
+    void play(uint8_t pattern);
+    uint8_t patternCount();
+    void printStats();
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "beepr_alert_seq.h"
+
+// Bounds a tick that runs into a pattern without any Wait.
+static const uint8_t MAX_OPS_PER_TICK = 32;
+
+static void finish(AlertSeqState &state)
+{
+    state.out = AlertOutputs();
+    state.playing = false;
+}
+
+void BeeprAlertSeq::reset(AlertSeqState &state)
+{
+    state = AlertSeqState();
+}
+
+AlertRequestResult BeeprAlertSeq::request(AlertSeqState &state, const uint8_t *pattern, uint8_t priority,
+                                          uint32_t nowMs, uint32_t coalesceMs)
+{
+    if (!pattern)
+    {
+        return AlertIgnored;
+    }
+    bool recent = state.started > 0 && (nowMs - state.lastStartMs) < coalesceMs;
+    if (state.playing && priority < state.priority)
+    {
+        state.ignored++;
+        return AlertIgnored;
+    }
+    if ((state.playing && priority == state.priority) || (!state.playing && recent && priority <= state.priority))
+    {
+        state.coalesced++;
+        return AlertCoalesced;
+    }
+
+    AlertRequestResult result = state.playing ? AlertPreempted : AlertStarted;
+    if (state.playing)
+    {
+        state.preempted++;
+    }
+    state.started++;
+    state.pattern = pattern;
+    state.pc = 0;
+    state.waitTicks = 0;
+    state.loopsDone = 0;
+    state.priority = priority;
+    state.playing = true;
+    state.out = AlertOutputs();
+    state.lastStartMs = nowMs;
+    return result;
+}
+
+bool BeeprAlertSeq::tick(AlertSeqState &state)
+{
+    if (!state.playing)
+    {
+        return false;
+    }
+    if (state.waitTicks > 0 && --state.waitTicks > 0)
+    {
+        return true;
+    }
+
+    for (uint8_t ops = 0; ops < MAX_OPS_PER_TICK; ops++)
+    {
+        const uint8_t *p = state.pattern + state.pc;
+        switch (p[0])
+        {
+        case AlertOpTone:
+            state.out.toneHz = (uint16_t)(p[1] * 20);
+            break;
+        case AlertOpLed:
+            state.out.led = p[1];
+            break;
+        case AlertOpVib:
+            state.out.vib = p[1];
+            break;
+        case AlertOpWait:
+            state.pc += 2;
+            if (p[1] > 0)
+            {
+                state.waitTicks = p[1];
+                return true;
+            }
+            continue;
+        case AlertOpLoop:
+            if (state.loopsDone < p[1])
+            {
+                state.loopsDone++;
+                state.pc = 0;
+                continue;
+            }
+            break;
+        default:
+            // AlertOpEnd, or a corrupt pattern.
+            finish(state);
+            return false;
+        }
+        state.pc += 2;
+    }
+    return true;
+}
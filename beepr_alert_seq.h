@@ -0,0 +1,74 @@
+#ifndef BEEPR_ALERT_SEQ_H
+#define BEEPR_ALERT_SEQ_H
+
+#include <stdint.h>
+
+// Alert pattern sequencer. Pure logic with no Arduino or IDF dependencies:
+// the caller ticks it every ALERT_TICK_MS (a hardware timer on the device, a
+// loop on a host) and drives the outputs from state.out.
+
+static const uint32_t ALERT_TICK_MS = 10;
+
+// Pattern bytecode: opcode byte plus one argument byte, ending with
+// AlertOpEnd. Set ops take effect immediately; only Wait consumes time.
+enum AlertOp : uint8_t
+{
+    AlertOpEnd = 0x00,  // All outputs off, pattern done.
+    AlertOpTone = 0x01, // Buzzer at arg * 20 Hz, 0 silences it.
+    AlertOpLed = 0x02,  // LED duty 0-255.
+    AlertOpVib = 0x03,  // Vibration motor duty 0-255.
+    AlertOpWait = 0x04, // Hold the outputs for arg ticks.
+    AlertOpLoop = 0x05  // Replay from the start arg more times (one per pattern).
+};
+
+#define ALERT_TONE(hz) AlertOpTone, (uint8_t)((hz) / 20)
+#define ALERT_LED(duty) AlertOpLed, (uint8_t)(duty)
+#define ALERT_VIB(duty) AlertOpVib, (uint8_t)(duty)
+#define ALERT_WAIT(ms) AlertOpWait, (uint8_t)((ms) / ALERT_TICK_MS)
+#define ALERT_LOOP(n) AlertOpLoop, (uint8_t)(n)
+#define ALERT_END AlertOpEnd
+
+struct AlertOutputs
+{
+    uint16_t toneHz;
+    uint8_t led;
+    uint8_t vib;
+};
+
+enum AlertRequestResult : uint8_t
+{
+    AlertStarted = 0,
+    AlertPreempted = 1, // Started, cutting off a lower-priority pattern.
+    AlertCoalesced = 2, // Folded into the pattern playing or just played.
+    AlertIgnored = 3    // A higher-priority pattern is playing.
+};
+
+struct AlertSeqState
+{
+    const uint8_t *pattern;
+    uint16_t pc;
+    uint8_t waitTicks;
+    uint8_t loopsDone;
+    uint8_t priority;
+    bool playing;
+    AlertOutputs out;
+    uint32_t lastStartMs;
+
+    uint32_t started;
+    uint32_t preempted;
+    uint32_t coalesced;
+    uint32_t ignored;
+};
+
+namespace BeeprAlertSeq
+{
+    void reset(AlertSeqState &state);
+    // A request at the priority of the running pattern, or at no more than
+    // the last one's within coalesceMs of its start, is coalesced.
+    AlertRequestResult request(AlertSeqState &state, const uint8_t *pattern, uint8_t priority, uint32_t nowMs,
+                               uint32_t coalesceMs);
+    // Advances one tick; false once the pattern has ended.
+    bool tick(AlertSeqState &state);
+}
+
+#endif
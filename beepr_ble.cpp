@@ -1,66 +1,114 @@
 #include "beepr_ble.h"
+#include "beepr_adv_state.h"
 #include "beepr_config.h"
+#include "beepr_log.h"
 #include "beepr_display.h"
+#include "beepr_events.h"
+#include "beepr_filter.h"
+#include "beepr_flightrec.h"
 #include "beepr_notifs.h"
 #include "knownApps.h"
 
-#include "esp_gap_ble_api.h"
+#include <BLEDevice.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
-
-static bool ancsReadyLogged = false;
-static uint32_t lastKeepAliveMs = 0;
-static QueueHandle_t pendingNotifQueue = nullptr;
-
-enum PendingEventType : uint8_t
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gattc_api.h"
+
+// ANCS discovery and subscription run inside the esp32notifications library,
+// which looks the service up through BLEClient::getService() on every connect
+// and has no way to take handles from outside. A reconnect only skips
+// discovery if Bluedroid's GATT client cache keeps the handles in NVS, which
+// is a core build option. `ble` reports where each service search was served
+// from, so a core without the cache shows up at runtime.
+struct GattSearchStats
 {
-    PendingEventAdd = 0,
-    PendingEventRemove = 1
+    uint32_t searches;
+    uint32_t fromCache;
+    uint32_t fromRemote;
+    uint32_t failed;
+    uint32_t lastMs;
+    esp_service_source_t lastSource;
 };
 
-struct PendingNotifEvent
+// Connect to first ANCS notification: covers encryption, ANCS discovery and
+// subscription, i.e. what a GATT cache hit would save.
+struct ReconnectStats
 {
-    PendingEventType type;
-    uint32_t uid;
-    NotificationCategory category;
-    uint8_t categoryCount;
-    uint32_t time;
-    char appName[80];
-    char title[120];
-    char message[200];
+    uint32_t connects;
+    uint32_t measured;
+    uint32_t lastMs;
+    uint32_t minMs;
+    uint32_t maxMs;
+    uint64_t totalMs;
+    uint32_t lastEncryptedMs;
+};
+
+// Gap between events while the lanes drain, so a burst does not hog core 0.
+static const uint32_t EVENT_PACE_MS = 5;
+
+static bool ancsReadyLogged = false;
+static uint32_t lastKeepAliveMs = 0;
+static TaskHandle_t bleTaskHandle = nullptr;
+static volatile uint32_t connectedAtMs = 0;
+static volatile uint32_t encryptedAtMs = 0;
+static volatile bool awaitingFirstNotification = false;
+static ReconnectStats reconnectStats = {};
+static GattSearchStats gattSearchStats = {};
+
+// Intervals follow Apple's accessory design guidelines: 20 ms first, then
+// their recommended 152.5, 417.5 and 1285 ms steps.
+static const AdvStep reconnectSchedule[] = {
+    {32, ADV_FAST_WINDOW_MS},
+    {244, ADV_MEDIUM_WINDOW_MS},
+    {668, ADV_SLOW_WINDOW_MS},
+    {2056, 0},
+};
+static const AdvStep pairingSchedule[] = {
+    {32, ADV_PAIRING_WINDOW_MS},
+    {244, ADV_MEDIUM_WINDOW_MS},
+    {668, ADV_SLOW_WINDOW_MS},
+    {2056, 0},
 };
 
-static void copyStringToBuffer(const String &src, char *dst, size_t dstSize)
+// Held across the controller calls so interval changes reach the radio in the
+// order the state machine decided them.
+static SemaphoreHandle_t advMutex = nullptr;
+static AdvState advState;
+
+static void copyToBuffer(const char *src, size_t srcLen, char *dst, size_t dstSize)
 {
     if (!dst || dstSize == 0)
     {
         return;
     }
-    src.toCharArray(dst, dstSize);
-    dst[dstSize - 1] = '\0';
+    size_t n = srcLen < dstSize - 1 ? srcLen : dstSize - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
 }
 
-static bool enqueuePendingEvent(const PendingNotifEvent &event)
+static void applyAdvLocked(AdvAction action)
 {
-    if (!pendingNotifQueue)
-    {
-        return false;
-    }
-
-    if (xQueueSend(pendingNotifQueue, &event, 0) == pdTRUE)
+    if (action != AdvActionRestart)
     {
-        return true;
+        return;
     }
-
-    // Queue full: drop oldest and retry, so fresh events keep flowing.
-    PendingNotifEvent dropped;
-    xQueueReceive(pendingNotifQueue, &dropped, 0);
-    return xQueueSend(pendingNotifQueue, &event, 0) == pdTRUE;
+    uint16_t units = BeeprAdvState::intervalUnits(advState);
+    BLEAdvertising *advertising = BLEDevice::getAdvertising();
+    advertising->stop();
+    advertising->setMinInterval(units);
+    advertising->setMaxInterval(units);
+    notifications.startAdvertising();
+    BEEPR_LOGI("Advertising at %lu.%02lums (step %u)\n", (unsigned long)(units * 625UL / 1000),
+               (unsigned long)(units * 625UL % 1000 / 10), (unsigned)advState.step);
 }
 
-static void logAdvertisingStarted()
+static void startAdvertising(const AdvStep *steps, uint8_t stepCount)
 {
-    Serial.println("Advertising started");
+    xSemaphoreTake(advMutex, portMAX_DELAY);
+    applyAdvLocked(BeeprAdvState::start(advState, steps, stepCount, millis()));
+    xSemaphoreGive(advMutex);
 }
 
 static void clearAllBonds()
@@ -68,14 +116,14 @@ static void clearAllBonds()
     int dev_num = esp_ble_get_bond_device_num();
     if (dev_num <= 0)
     {
-        Serial.println("No stored bonds to clear");
+        BEEPR_LOGI("No stored bonds to clear\n");
         return;
     }
 
     esp_ble_bond_dev_t *dev_list = (esp_ble_bond_dev_t *)malloc(sizeof(esp_ble_bond_dev_t) * dev_num);
     if (!dev_list)
     {
-        Serial.println("Failed to allocate bond list");
+        BEEPR_LOGE("Failed to allocate bond list\n");
         return;
     }
 
@@ -88,7 +136,7 @@ static void clearAllBonds()
     }
 
     free(dev_list);
-    Serial.printf("Cleared %d stored bond(s)\n", dev_num_copy);
+    BEEPR_LOGI("Cleared %d stored bond(s)\n", dev_num_copy);
 }
 
 static void gapCallback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
@@ -97,67 +145,153 @@ static void gapCallback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *pa
     {
         if (param->ble_security.auth_cmpl.success)
         {
-            Serial.println("Bonded/Encrypted");
+            const uint8_t *a = param->ble_security.auth_cmpl.bd_addr;
+            encryptedAtMs = millis();
+            BeeprFlightRec::record(FlightEncrypted, 1);
+            BEEPR_LOGI("Bonded/Encrypted %02x:%02x:%02x:%02x:%02x:%02x (+%lums)\n", a[0], a[1], a[2], a[3],
+                       a[4], a[5], (unsigned long)(encryptedAtMs - connectedAtMs));
         }
         else
         {
-            Serial.println("Bonding failed");
+            BeeprFlightRec::record(FlightEncrypted, 0);
+            BEEPR_LOGW("Bonding failed\n");
         }
     }
 }
 
+static const char *serviceSourceName(esp_service_source_t source)
+{
+    switch (source)
+    {
+    case ESP_GATT_SERVICE_FROM_NVS_FLASH:
+        return "NVS cache";
+    case ESP_GATT_SERVICE_FROM_REMOTE_DEVICE:
+        return "phone";
+    default:
+        return "unknown";
+    }
+}
+
+// Chained after the BLE library's own GATT client handling.
+static void gattcCallback(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t *param)
+{
+    (void)gattcIf;
+    if (event != ESP_GATTC_SEARCH_CMPL_EVT)
+    {
+        return;
+    }
+    GattSearchStats &s = gattSearchStats;
+    s.searches++;
+    s.lastMs = millis() - connectedAtMs;
+    if (param->search_cmpl.status != ESP_GATT_OK)
+    {
+        s.failed++;
+        s.lastSource = ESP_GATT_SERVICE_FROM_UNKNOWN;
+        BEEPR_LOGW("GATT service search failed (status %d)\n", (int)param->search_cmpl.status);
+        return;
+    }
+    s.lastSource = param->search_cmpl.searched_service_source;
+    if (s.lastSource == ESP_GATT_SERVICE_FROM_NVS_FLASH)
+    {
+        s.fromCache++;
+    }
+    else if (s.lastSource == ESP_GATT_SERVICE_FROM_REMOTE_DEVICE)
+    {
+        s.fromRemote++;
+    }
+    BEEPR_LOGI("GATT services from %s (+%lums)\n", serviceSourceName(s.lastSource), (unsigned long)s.lastMs);
+}
+
 static void onBLEStateChanged(BLENotifications::State state)
 {
+    uint32_t advertisedMs;
     switch (state)
     {
     case BLENotifications::StateConnected:
-        Serial.println("Connected");
-        Serial.println("ANCS client starting (subscribing)");
+        connectedAtMs = millis();
+        encryptedAtMs = connectedAtMs;
+        awaitingFirstNotification = true;
+        ancsReadyLogged = false;
+        reconnectStats.connects++;
+        BeeprFlightRec::record(FlightConnected);
+        xSemaphoreTake(advMutex, portMAX_DELAY);
+        BeeprAdvState::onConnected(advState, connectedAtMs);
+        advertisedMs = advState.lastConnectMs;
+        xSemaphoreGive(advMutex);
+        BEEPR_LOGI("Connected after %lums of advertising\n", (unsigned long)advertisedMs);
+        BEEPR_LOGI("ANCS client starting (subscribing)\n");
         break;
     case BLENotifications::StateDisconnected:
-        Serial.println("Disconnected");
-        notifications.startAdvertising();
-        logAdvertisingStarted();
+        awaitingFirstNotification = false;
+        BeeprFlightRec::record(FlightDisconnected);
+        BEEPR_LOGI("Disconnected\n");
+        startAdvertising(reconnectSchedule, sizeof(reconnectSchedule) / sizeof(reconnectSchedule[0]));
         break;
     }
 }
 
-static void printNotificationCommon(const PendingNotifEvent &event)
+static void printNotificationCommon(const PendingNotifEvent &event, const NotifRecord &rec)
 {
-    Serial.println("Notification received");
-    if (event.appName[0] != '\0')
+    BEEPR_LOGI("Notification received\n");
+    if (rec.app[0] != '\0')
     {
-        Serial.printf("App: %s\n", event.appName);
+        BEEPR_LOGI("App: %s\n", rec.app);
     }
     else
     {
-        Serial.println("App: (unknown)");
+        BEEPR_LOGI("App: (unknown)\n");
     }
-    Serial.printf("Title: %s\n", event.title[0] ? event.title : "(none)");
-    Serial.printf("Message: %s\n", event.message[0] ? event.message : "(none)");
+    BEEPR_LOGI("Title: %s\n", rec.title[0] ? rec.title : "(none)");
+    BEEPR_LOGI("Message: %s\n", rec.message[0] ? rec.message : "(none)");
 
     if (event.time != 0)
     {
-        Serial.printf("Date: %lu\n", (unsigned long)event.time);
+        BEEPR_LOGI("Date: %lu\n", (unsigned long)event.time);
     }
     else
     {
-        Serial.println("Date: (not provided)");
+        BEEPR_LOGI("Date: (not provided)\n");
     }
 
-    Serial.printf("Category: %s\n", notifications.getNotificationCategoryDescription(event.category));
-    Serial.printf("CategoryCount: %u\n", event.categoryCount);
-    Serial.printf("UUID: %lu\n", (unsigned long)event.uid);
-    Serial.printf("-------------------------------------");
+    BEEPR_LOGI("Category: %s\n", notifications.getNotificationCategoryDescription(event.category));
+    BEEPR_LOGI("CategoryCount: %u\n", event.categoryCount);
+    BEEPR_LOGI("UUID: %lu\n", (unsigned long)event.uid);
+    BEEPR_LOGI("-------------------------------------");
+}
+
+static void recordFirstNotification(uint32_t now)
+{
+    ReconnectStats &s = reconnectStats;
+    uint32_t ms = now - connectedAtMs;
+    s.measured++;
+    s.lastMs = ms;
+    s.totalMs += ms;
+    s.lastEncryptedMs = encryptedAtMs - connectedAtMs;
+    BeeprFlightRec::record(FlightFirstNotif, 0, (uint16_t)(ms > 0xFFFF ? 0xFFFF : ms));
+    if (s.measured == 1 || ms < s.minMs)
+    {
+        s.minMs = ms;
+    }
+    if (ms > s.maxMs)
+    {
+        s.maxMs = ms;
+    }
+    BEEPR_LOGI("First notification %lums after connect (encrypted at +%lums)\n", (unsigned long)ms,
+               (unsigned long)s.lastEncryptedMs);
 }
 
 static void onNotificationArrived(const ArduinoNotification *notification, const Notification *rawNotificationData)
 {
     (void)rawNotificationData;
 
+    if (awaitingFirstNotification)
+    {
+        awaitingFirstNotification = false;
+        recordFirstNotification(millis());
+    }
     if (!ancsReadyLogged)
     {
-        Serial.println("ANCS ready/subscribed");
+        BEEPR_LOGI("ANCS ready/subscribed\n");
         ancsReadyLogged = true;
     }
 
@@ -168,22 +302,56 @@ static void onNotificationArrived(const ArduinoNotification *notification, const
         return;
     }
 
+    // Drop filtered apps/categories before paying for copies, queueing or rendering.
+    FilterVerdict verdict = BeeprFilter::evaluate(notification->type, notification->category, notification->title);
+    if (!verdict.allow)
+    {
+        return;
+    }
+
+    // The record is the notification's final storage: this is the only copy
+    // of its text; the event lanes and the store just pass the index around.
     PendingNotifEvent event = {};
+    event.record = BeeprNotifs::claimRecord();
+    NotifRecord *rec = BeeprNotifs::record(event.record);
+    if (!rec)
+    {
+        BEEPR_LOGW("Notification dropped (record pool exhausted)\n");
+        return;
+    }
     event.type = PendingEventAdd;
     event.uid = notification->uuid;
     event.category = notification->category;
     event.categoryCount = notification->categoryCount;
     event.time = notification->time;
 
-    String appName = notification->type.length() ? getAppName(notification->type) : String("(unknown)");
-    String contact = notification->title.length() ? notification->title : String("(none)");
-    String message = notification->message.length() ? notification->message : String("");
+    const String &type = notification->type;
+    int appIndex = verdict.appIndex >= 0 ? verdict.appIndex : findAppIndex(type.c_str(), type.length());
+    if (appIndex >= 0)
+    {
+        copyToBuffer(kAppNames[appIndex].appName, strlen(kAppNames[appIndex].appName), rec->app, sizeof(rec->app));
+    }
+    else if (type.length())
+    {
+        copyToBuffer(type.c_str(), type.length(), rec->app, sizeof(rec->app));
+    }
+    else
+    {
+        copyToBuffer("(unknown)", 9, rec->app, sizeof(rec->app));
+    }
 
-    copyStringToBuffer(appName, event.appName, sizeof(event.appName));
-    copyStringToBuffer(contact, event.title, sizeof(event.title));
-    copyStringToBuffer(message, event.message, sizeof(event.message));
+    const String &title = notification->title;
+    if (title.length())
+    {
+        copyToBuffer(title.c_str(), title.length(), rec->title, sizeof(rec->title));
+    }
+    else
+    {
+        copyToBuffer("(none)", 6, rec->title, sizeof(rec->title));
+    }
+    copyToBuffer(notification->message.c_str(), notification->message.length(), rec->message, sizeof(rec->message));
 
-    enqueuePendingEvent(event);
+    BeeprEvents::enqueue(event);
 }
 
 static void onNotificationRemoved(const ArduinoNotification *notification, const Notification *rawNotificationData)
@@ -196,34 +364,36 @@ static void onNotificationRemoved(const ArduinoNotification *notification, const
     }
     PendingNotifEvent event = {};
     event.type = PendingEventRemove;
+    event.record = NOTIF_NO_RECORD;
     event.uid = notification->uuid;
     event.category = notification->category;
     event.categoryCount = notification->categoryCount;
     event.time = notification->time;
-    enqueuePendingEvent(event);
+    BeeprEvents::enqueue(event);
 }
 
 static void processPendingEvents()
 {
-    if (!pendingNotifQueue)
-    {
-        return;
-    }
-
     PendingNotifEvent event = {};
     uint8_t processed = 0;
-    // Process one queued event per tick to keep button/UI latency low.
-    while (processed < 1 && xQueueReceive(pendingNotifQueue, &event, 0) == pdTRUE)
+    // Process one queued event per tick (highest lane first) to keep
+    // button/UI latency low.
+    while (processed < 1 && BeeprEvents::dequeue(event))
     {
         if (event.type == PendingEventAdd)
         {
-            printNotificationCommon(event);
-            BeeprNotifs::add(String(event.appName), String(event.title), String(event.message), event.uid);
+            const NotifRecord *rec = BeeprNotifs::record(event.record);
+            if (!rec)
+            {
+                continue;
+            }
+            printNotificationCommon(event, *rec);
+            BeeprNotifs::add(event.record, event.uid, (uint8_t)event.category);
         }
         else
         {
-            Serial.println("Notification removed");
-            Serial.printf("UUID: %lu\n", (unsigned long)event.uid);
+            BEEPR_LOGI("Notification removed\n");
+            BEEPR_LOGI("UUID: %lu\n", (unsigned long)event.uid);
             BeeprNotifs::removeByUid(event.uid);
         }
         processed++;
@@ -235,50 +405,122 @@ void BeeprBle::begin(bool pairingMode)
     bool ok = notifications.begin(DEVICE_NAME);
     if (ok)
     {
-        Serial.println("BLE init OK");
+        BEEPR_LOGI("BLE init OK\n");
     }
     else
     {
-        Serial.println("BLE init FAILED");
+        BEEPR_LOGE("BLE init FAILED\n");
     }
 
-    if (!pendingNotifQueue)
-    {
-        pendingNotifQueue = xQueueCreate(24, sizeof(PendingNotifEvent));
-        if (!pendingNotifQueue)
-        {
-            Serial.println("Failed to create notification queue");
-        }
-    }
+    BeeprEvents::begin();
+    BeeprFilter::begin();
 
     notifications.setConnectionStateChangedCallback(onBLEStateChanged);
     notifications.setNotificationCallback(onNotificationArrived);
     notifications.setRemovedCallback(onNotificationRemoved);
 
     esp_ble_gap_register_callback(gapCallback);
+    BLEDevice::setCustomGattcHandler(gattcCallback);
 
+    advMutex = xSemaphoreCreateMutex();
+    BeeprAdvState::reset(advState);
     if (pairingMode)
     {
         clearAllBonds();
-        notifications.startAdvertising();
-        logAdvertisingStarted();
+        startAdvertising(pairingSchedule, sizeof(pairingSchedule) / sizeof(pairingSchedule[0]));
     }
     else
     {
-        // Always start advertising in normal mode as well.
-        notifications.startAdvertising();
-        logAdvertisingStarted();
+        // A bonded phone reconnects on its own; advertise as after a drop.
+        startAdvertising(reconnectSchedule, sizeof(reconnectSchedule) / sizeof(reconnectSchedule[0]));
+    }
+}
+
+void BeeprBle::noteActivity()
+{
+    if (!advMutex)
+    {
+        return;
+    }
+    xSemaphoreTake(advMutex, portMAX_DELAY);
+    applyAdvLocked(BeeprAdvState::onActivity(advState, millis()));
+    xSemaphoreGive(advMutex);
+    // The fast window's end is a new deadline.
+    if (bleTaskHandle)
+    {
+        xTaskNotifyGive(bleTaskHandle);
     }
 }
 
-void BeeprBle::update()
+void BeeprBle::attachTask(TaskHandle_t task)
+{
+    bleTaskHandle = task;
+    BeeprEvents::attachConsumer(task);
+    BeeprNotifs::attachTimerTask(task);
+}
+
+void BeeprBle::printStats()
+{
+    const ReconnectStats &s = reconnectStats;
+    Serial.printf("BLE: connects=%lu, connect to first notification: last=%lums min=%lums max=%lums avg=%lums\n",
+                  (unsigned long)s.connects, (unsigned long)s.lastMs, (unsigned long)s.minMs,
+                  (unsigned long)s.maxMs, (unsigned long)(s.measured ? s.totalMs / s.measured : 0));
+    Serial.printf("BLE: last encryption +%lums, GATT client cache in NVS: %s\n", (unsigned long)s.lastEncryptedMs,
+#if CONFIG_BT_GATTC_CACHE_NVS_FLASH
+                  "on"
+#else
+                  "off (core built without CONFIG_BT_GATTC_CACHE_NVS_FLASH)"
+#endif
+    );
+    const GattSearchStats &g = gattSearchStats;
+    Serial.printf("BLE: service searches=%lu, from cache=%lu, from phone=%lu, failed=%lu, last from %s +%lums\n",
+                  (unsigned long)g.searches, (unsigned long)g.fromCache, (unsigned long)g.fromRemote,
+                  (unsigned long)g.failed, g.searches ? serviceSourceName(g.lastSource) : "none",
+                  (unsigned long)g.lastMs);
+
+    xSemaphoreTake(advMutex, portMAX_DELAY);
+    AdvState a = advState;
+    xSemaphoreGive(advMutex);
+    uint32_t now = millis();
+    Serial.printf("BLE: advertising %s, step %u, activity resets=%lu\n", a.advertising ? "on" : "off",
+                  (unsigned)a.step, (unsigned long)a.activityResets);
+    Serial.printf("BLE: time to reconnect: n=%lu last=%lums min=%lums max=%lums avg=%lums\n",
+                  (unsigned long)a.connects, (unsigned long)a.lastConnectMs, (unsigned long)a.minConnectMs,
+                  (unsigned long)a.maxConnectMs,
+                  (unsigned long)(a.connects ? a.totalConnectMs / a.connects : 0));
+    for (uint8_t i = 0; i < a.stepCount; i++)
+    {
+        uint16_t units = a.steps[i].intervalUnits;
+        Serial.printf("  step %u %5lu.%02lums: %8lums advertising, %lu connects\n", (unsigned)i,
+                      (unsigned long)(units * 625UL / 1000), (unsigned long)(units * 625UL % 1000 / 10),
+                      (unsigned long)BeeprAdvState::stepResidency(a, i, now), (unsigned long)a.connectsAtStep[i]);
+    }
+}
+
+uint32_t BeeprBle::update()
 {
     processPendingEvents();
 
     uint32_t now = millis();
+    xSemaphoreTake(advMutex, portMAX_DELAY);
+    applyAdvLocked(BeeprAdvState::onTick(advState, now));
+    uint32_t waitMs = BeeprAdvState::msUntilTick(advState, now);
+    xSemaphoreGive(advMutex);
+
     if (now - lastKeepAliveMs >= KEEPALIVE_MS)
     {
         notifications.keepAlive();
         lastKeepAliveMs = now;
     }
+    uint32_t keepAliveMs = KEEPALIVE_MS - (now - lastKeepAliveMs);
+    waitMs = keepAliveMs < waitMs ? keepAliveMs : waitMs;
+
+    // Expiry and the age on screen share this task's single wait.
+    uint32_t storeMs = BeeprNotifs::update();
+    waitMs = storeMs < waitMs ? storeMs : waitMs;
+    if (BeeprEvents::pendingCount() > 0 && EVENT_PACE_MS < waitMs)
+    {
+        waitMs = EVENT_PACE_MS;
+    }
+    return waitMs;
 }
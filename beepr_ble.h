@@ -3,13 +3,22 @@
 
 #include <Arduino.h>
 #include "esp32notifications.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 extern BLENotifications notifications;
 
 namespace BeeprBle
 {
     void begin(bool pairingMode);
-    void update();
+    // Called once by the task that runs update(): queued events, button
+    // activity and new store deadlines wake it.
+    void attachTask(TaskHandle_t task);
+    // Returns how long the task may sleep before the next call, unless woken.
+    uint32_t update();
+    // Button activity: restarts the fast advertising window.
+    void noteActivity();
+    void printStats();
 }
 
 #endif
@@ -1,107 +1,135 @@
 #include "beepr_buttons.h"
+#include "beepr_ble.h"
 #include "beepr_config.h"
+#include "beepr_log.h"
 #include "beepr_notifs.h"
+#include "beepr_power.h"
 
 #include <Arduino.h>
+#include "driver/gpio.h"
+#include "soc/gpio_struct.h"
 
+// Buttons are level-triggered so the same lines can wake the CPU from light
+// sleep. The ISR masks its pin and wakes the button task, which polls only
+// until the button has been released for BTN_DEBOUNCE_MS and then re-arms it;
+// with nothing held the task blocks indefinitely.
 struct DebouncedButton
 {
     uint8_t pin;
     int lastReadState;
-    int stableState;
     uint32_t lastChangeMs;
+    volatile bool pressPending;
+    volatile bool armed;
 };
 
-static DebouncedButton nextBtn = {BTN_NEXT_PIN, HIGH, HIGH, 0};
-static DebouncedButton clearBtn = {BTN_CLEAR_PIN, HIGH, HIGH, 0};
-static volatile bool nextPressPending = false;
-static volatile bool clearPressPending = false;
-static volatile uint32_t nextLastIsrUs = 0;
-static volatile uint32_t clearLastIsrUs = 0;
-static const uint32_t BTN_DEBOUNCE_US = BTN_DEBOUNCE_MS * 1000UL;
+static DebouncedButton nextBtn = {BTN_NEXT_PIN, HIGH, 0, false, true};
+static DebouncedButton clearBtn = {BTN_CLEAR_PIN, HIGH, 0, false, true};
+static TaskHandle_t waiterTask = nullptr;
 
-void IRAM_ATTR onNextButtonIsr()
+static void IRAM_ATTR onButtonLow(DebouncedButton &btn)
 {
-    uint32_t now = micros();
-    if ((now - nextLastIsrUs) >= BTN_DEBOUNCE_US)
+    // gpio_intr_disable() lives in flash; the pin's interrupt enable bits
+    // are cleared directly so the ISR stays safe with the cache off.
+    GPIO.pin[btn.pin].int_ena = 0;
+    btn.armed = false;
+    btn.pressPending = true;
+    if (waiterTask)
     {
-        nextLastIsrUs = now;
-        nextPressPending = true;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(waiterTask, &woken);
+        portYIELD_FROM_ISR(woken);
     }
 }
 
+void IRAM_ATTR onNextButtonIsr()
+{
+    onButtonLow(nextBtn);
+}
+
 void IRAM_ATTR onClearButtonIsr()
 {
-    uint32_t now = micros();
-    if ((now - clearLastIsrUs) >= BTN_DEBOUNCE_US)
-    {
-        clearLastIsrUs = now;
-        clearPressPending = true;
-    }
+    onButtonLow(clearBtn);
 }
 
-static bool consumePress(DebouncedButton &btn, uint32_t now)
+// Returns true once per press and re-arms the interrupt after a stable release.
+static bool takePress(DebouncedButton &btn, uint32_t now)
 {
-    int raw = digitalRead(btn.pin);
-    if (raw != btn.lastReadState)
+    bool pressed = false;
+    if (btn.pressPending)
     {
-        btn.lastReadState = raw;
+        btn.pressPending = false;
+        pressed = true;
+        // Require a full debounce window of HIGH from here on.
+        btn.lastReadState = LOW;
         btn.lastChangeMs = now;
     }
 
-    if ((now - btn.lastChangeMs) < BTN_DEBOUNCE_MS)
+    if (!btn.armed)
     {
-        return false;
+        int raw = digitalRead(btn.pin);
+        if (raw != btn.lastReadState)
+        {
+            btn.lastReadState = raw;
+            btn.lastChangeMs = now;
+        }
+        if (raw == HIGH && (now - btn.lastChangeMs) >= BTN_DEBOUNCE_MS)
+        {
+            btn.armed = true;
+            gpio_intr_enable((gpio_num_t)btn.pin);
+        }
     }
-
-    if (btn.stableState != btn.lastReadState)
-    {
-        int prevStable = btn.stableState;
-        btn.stableState = btn.lastReadState;
-        // Trigger exactly once on stable HIGH -> LOW transition.
-        return (prevStable == HIGH && btn.stableState == LOW);
-    }
-
-    return false;
+    return pressed;
 }
 
 void BeeprButtons::begin()
 {
     pinMode(BTN_NEXT_PIN, INPUT_PULLUP);
     pinMode(BTN_CLEAR_PIN, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(BTN_NEXT_PIN), onNextButtonIsr, FALLING);
-    attachInterrupt(digitalPinToInterrupt(BTN_CLEAR_PIN), onClearButtonIsr, FALLING);
 
-    // Seed debouncer states from actual pin levels.
+    // Seed debouncer states from actual pin levels before arming.
     nextBtn.lastReadState = digitalRead(nextBtn.pin);
-    nextBtn.stableState = nextBtn.lastReadState;
     nextBtn.lastChangeMs = millis();
-
     clearBtn.lastReadState = digitalRead(clearBtn.pin);
-    clearBtn.stableState = clearBtn.lastReadState;
     clearBtn.lastChangeMs = millis();
 
-    Serial.printf("Buttons ready: NEXT=%d CLEAR=%d\n", BTN_NEXT_PIN, BTN_CLEAR_PIN);
-    Serial.printf("Button idle states: NEXT=%s CLEAR=%s\n",
-                  nextBtn.stableState == LOW ? "LOW" : "HIGH",
-                  clearBtn.stableState == LOW ? "LOW" : "HIGH");
+    attachInterrupt(digitalPinToInterrupt(BTN_NEXT_PIN), onNextButtonIsr, ONLOW);
+    attachInterrupt(digitalPinToInterrupt(BTN_CLEAR_PIN), onClearButtonIsr, ONLOW);
+
+    BEEPR_LOGI("Buttons ready: NEXT=%d CLEAR=%d\n", BTN_NEXT_PIN, BTN_CLEAR_PIN);
+    BEEPR_LOGI("Button idle states: NEXT=%s CLEAR=%s\n",
+               nextBtn.lastReadState == LOW ? "LOW" : "HIGH",
+               clearBtn.lastReadState == LOW ? "LOW" : "HIGH");
 }
 
-void BeeprButtons::update()
+void BeeprButtons::attachTask(TaskHandle_t task)
+{
+    waiterTask = task;
+}
+
+bool BeeprButtons::update()
 {
     uint32_t now = millis();
 
-    if (nextPressPending || consumePress(nextBtn, now))
+    if (takePress(nextBtn, now))
     {
-        nextPressPending = false;
-        Serial.println("BTN_NEXT pressed");
-        BeeprNotifs::next();
+        BEEPR_LOGI("BTN_NEXT pressed\n");
+        BeeprBle::noteActivity();
+        // A press that wakes the panel only wakes it.
+        if (!BeeprPower::noteButton())
+        {
+            BeeprNotifs::next();
+        }
     }
 
-    if (clearPressPending || consumePress(clearBtn, now))
+    if (takePress(clearBtn, now))
     {
-        clearPressPending = false;
-        Serial.println("BTN_CLEAR pressed");
-        BeeprNotifs::removeCurrent();
+        BEEPR_LOGI("BTN_CLEAR pressed\n");
+        BeeprBle::noteActivity();
+        if (!BeeprPower::noteButton())
+        {
+            BeeprNotifs::removeCurrent();
+        }
     }
+
+    return !nextBtn.armed || !clearBtn.armed;
 }
@@ -1,10 +1,16 @@
 #ifndef BEEPR_BUTTONS_H
 #define BEEPR_BUTTONS_H
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 namespace BeeprButtons
 {
     void begin();
-    void update();
+    // Task woken by button interrupts.
+    void attachTask(TaskHandle_t task);
+    // Returns true while a button is still settling and needs polling.
+    bool update();
 }
 
 #endif
@@ -3,17 +3,208 @@
 
 #include <Arduino.h>
 
+// Build presets. Pick one with -DBEEPR_PRESET=<n> (see "Build Presets" in the
+// README); single features can still be overridden, e.g. -DBEEPR_HAS_CONSOLE=0.
+#define BEEPR_PRESET_FULL 0     // OLED, buttons, alerts, serial console, info logs
+#define BEEPR_PRESET_HEADLESS 1 // BLE bridge with serial console, no panel or buttons
+#define BEEPR_PRESET_MINIMAL 2  // Headless, no console, small store, errors only
+#ifndef BEEPR_PRESET
+#define BEEPR_PRESET BEEPR_PRESET_FULL
+#endif
+
+#define BEEPR_LOG_NONE 0
+#define BEEPR_LOG_ERROR 1
+#define BEEPR_LOG_WARN 2
+#define BEEPR_LOG_INFO 3
+#define BEEPR_LOG_DEBUG 4
+
+// Features are preprocessor switches: a disabled one must not even pull in
+// its library (U8g2 for the panel).
+#if BEEPR_PRESET == BEEPR_PRESET_FULL
+#define BEEPR_PRESET_DISPLAY 1
+#define BEEPR_PRESET_BUTTONS 1
+#define BEEPR_PRESET_CONSOLE 1
+#define BEEPR_PRESET_ALERTS 1
+#define BEEPR_PRESET_LOG_LEVEL BEEPR_LOG_INFO
+#elif BEEPR_PRESET == BEEPR_PRESET_HEADLESS
+#define BEEPR_PRESET_DISPLAY 0
+#define BEEPR_PRESET_BUTTONS 0
+#define BEEPR_PRESET_CONSOLE 1
+#define BEEPR_PRESET_ALERTS 0
+#define BEEPR_PRESET_LOG_LEVEL BEEPR_LOG_INFO
+#elif BEEPR_PRESET == BEEPR_PRESET_MINIMAL
+#define BEEPR_PRESET_DISPLAY 0
+#define BEEPR_PRESET_BUTTONS 0
+#define BEEPR_PRESET_CONSOLE 0
+#define BEEPR_PRESET_ALERTS 0
+#define BEEPR_PRESET_LOG_LEVEL BEEPR_LOG_ERROR
+#else
+#error "Unknown BEEPR_PRESET"
+#endif
+
+#ifndef BEEPR_HAS_DISPLAY
+#define BEEPR_HAS_DISPLAY BEEPR_PRESET_DISPLAY
+#endif
+#ifndef BEEPR_HAS_BUTTONS
+#define BEEPR_HAS_BUTTONS BEEPR_PRESET_BUTTONS
+#endif
+#ifndef BEEPR_HAS_CONSOLE
+#define BEEPR_HAS_CONSOLE BEEPR_PRESET_CONSOLE
+#endif
+// Panel driver when BEEPR_HAS_DISPLAY is set (see beepr_panel_u8g2.h).
+#define BEEPR_PANEL_SH1106 0
+#define BEEPR_PANEL_SSD1306 1
+#ifndef BEEPR_PANEL
+#define BEEPR_PANEL BEEPR_PANEL_SH1106
+#endif
+#ifndef BEEPR_HAS_ALERTS
+#define BEEPR_HAS_ALERTS BEEPR_PRESET_ALERTS
+#endif
+#ifndef BEEPR_LOG_LEVEL
+#define BEEPR_LOG_LEVEL BEEPR_PRESET_LOG_LEVEL
+#endif
+
+// Sizes per preset. Only ever read into the constants below, never bound to
+// a reference, so the constexpr members need no out-of-class definition.
+template <int Preset>
+struct BeeprPresetSizes
+{
+    static constexpr uint8_t storeCapacity = 24;
+    static constexpr size_t appLen = 80;
+    static constexpr size_t titleLen = 120;
+    static constexpr size_t messageLen = 200;
+    static constexpr uint8_t urgentDepth = 4;
+    static constexpr uint8_t highDepth = 8;
+    static constexpr uint8_t bulkDepth = 16;
+    static constexpr uint8_t filterMaxRules = 16;
+};
+
+template <>
+struct BeeprPresetSizes<BEEPR_PRESET_MINIMAL>
+{
+    static constexpr uint8_t storeCapacity = 8;
+    static constexpr size_t appLen = 32;
+    static constexpr size_t titleLen = 48;
+    static constexpr size_t messageLen = 96;
+    static constexpr uint8_t urgentDepth = 2;
+    static constexpr uint8_t highDepth = 4;
+    static constexpr uint8_t bulkDepth = 8;
+    static constexpr uint8_t filterMaxRules = 4;
+};
+
+typedef BeeprPresetSizes<BEEPR_PRESET> BeeprSizes;
+
 // Pairing button to GND (GPIO33).
 static const int PAIRING_PIN = 33;
 // Notification navigation buttons (wired to GND, INPUT_PULLUP).
 static const int BTN_NEXT_PIN = 32;  // Next notification
 static const int BTN_CLEAR_PIN = 23; // Clear current notification
+// Alert outputs (see beepr_alert.h), -1 if not fitted: passive buzzer, LED
+// and vibration motor driver.
+static const int ALERT_BUZZER_PIN = 25;
+static const int ALERT_LED_PIN = 2;
+static const int ALERT_VIB_PIN = 26;
+// Alerts no more urgent than one started this recently are not replayed.
+static const uint32_t ALERT_COALESCE_MS = 3000;
 
 static const char *DEVICE_NAME = "BEEPR";
 
 static const uint32_t KEEPALIVE_MS = 20000;
 static const uint32_t BTN_DEBOUNCE_MS = 30;
 
+// Pending event lanes (see beepr_events.h), queue depth per lane.
+static const uint8_t EVENT_LANE_URGENT_DEPTH = BeeprSizes::urgentDepth;
+static const uint8_t EVENT_LANE_HIGH_DEPTH = BeeprSizes::highDepth;
+static const uint8_t EVENT_LANE_BULK_DEPTH = BeeprSizes::bulkDepth;
+// A remove that finds its lane full is parked instead of dropped, in a ring of
+// NOTIF_STORE_CAPACITY plus the lane depth per lane (see beepr_events.cpp).
+// Notification store. Every text record is either stored, queued in an
+// event lane, or in flight (one per producer plus one being committed).
+static const size_t NOTIF_APP_LEN = BeeprSizes::appLen;
+static const size_t NOTIF_TITLE_LEN = BeeprSizes::titleLen;
+static const size_t NOTIF_MESSAGE_LEN = BeeprSizes::messageLen;
+static const uint8_t NOTIF_STORE_CAPACITY = BeeprSizes::storeCapacity;
+// Published store views: the current one, one being built, and readers.
+static const uint8_t NOTIF_VIEW_POOL_SIZE = 6;
+// Records pinned only by a view (replaced or removed meanwhile) add one each.
+static const uint16_t NOTIF_RECORD_POOL_SIZE = NOTIF_STORE_CAPACITY + EVENT_LANE_URGENT_DEPTH +
+                                               EVENT_LANE_HIGH_DEPTH + EVENT_LANE_BULK_DEPTH + 3 +
+                                               NOTIF_VIEW_POOL_SIZE;
+// PSRAM tier (WROVER). With PSRAM, only NOTIF_HOT_RECORDS text records stay
+// in internal RAM; the rest of the pool moves to PSRAM, and the high and bulk
+// lanes spill into PSRAM backlogs of these depths instead of dropping.
+// Without PSRAM the pool stays internal and the backlogs are disabled.
+static const uint16_t NOTIF_HOT_RECORDS = 8;
+static const uint16_t EVENT_BACKLOG_HIGH = 64;
+static const uint16_t EVENT_BACKLOG_BULK = 192;
+// Notification expiry (see beepr_ttl_wheel.h): stored entries whose ANCS
+// remove never arrives, e.g. because the phone went out of range, are dropped
+// this many minutes after they last arrived; 0 keeps them until removed.
+// An identical re-send on reconnect restarts the timer.
+static const uint16_t NOTIF_TTL_RINGING_MIN = 2;    // Incoming call
+static const uint16_t NOTIF_TTL_MISSED_MIN = 1440;  // Missed call, voicemail
+static const uint16_t NOTIF_TTL_SCHEDULE_MIN = 120; // Schedule
+static const uint16_t NOTIF_TTL_NEWS_MIN = 180;     // News, entertainment
+static const uint16_t NOTIF_TTL_DEFAULT_MIN = 720;  // Everything else
+
+// Early-drop notification filter (see beepr_filter.h).
+static const uint8_t FILTER_MAX_RULES = BeeprSizes::filterMaxRules;
+static const size_t FILTER_TITLE_NEEDLE_LEN = 24;
+static const size_t FILTER_BUNDLE_ID_LEN = 64;
+static const char *FILTER_NVS_NAMESPACE = "beepr";
+static const char *FILTER_NVS_KEY = "filter";
+
+// Task stack sizes (bytes).
+static const uint32_t BUTTON_TASK_STACK = 4096;
+static const uint32_t BLE_TASK_STACK = 6144;
+static const uint32_t ALERT_TASK_STACK = 2048;
+
+// Marquee for messages wider than the panel: frame rate while scrolling,
+// hold at the start of each pass, and quiet time after a BLE burst.
+static const uint8_t MARQUEE_FPS = 20;
+static const uint32_t MARQUEE_START_HOLD_MS = 1000;
+static const uint32_t MARQUEE_BURST_HOLD_MS = 500;
+static const uint32_t MARQUEE_TASK_STACK = 3072;
+
+// Idle power management. The panel enters power-save after this long without
+// a button press or new notification (0 keeps it on). Light sleep needs a core
+// built with CONFIG_PM_ENABLE and tickless idle; otherwise it is skipped.
+static const uint32_t POWER_DISPLAY_TIMEOUT_MS = 60000;
+static const bool POWER_LIGHT_SLEEP = true;
+// UART input wakes the CPU but is not received while it sleeps, so a text
+// console session holds light sleep off until this long after its last byte.
+static const uint32_t POWER_CONSOLE_HOLD_MS = 120000;
+static const uint32_t POWER_NO_DEADLINE = 0xFFFFFFFFUL;
+
+// Advertising schedule (see beepr_ble.cpp). After a disconnect the device
+// advertises at 20 ms for the fast window, then backs off through longer
+// intervals; a button press restarts the fast window. Pairing mode keeps the
+// fast interval for the whole pairing window.
+static const uint32_t ADV_FAST_WINDOW_MS = 30000;
+static const uint32_t ADV_MEDIUM_WINDOW_MS = 120000;
+static const uint32_t ADV_SLOW_WINDOW_MS = 600000;
+static const uint32_t ADV_PAIRING_WINDOW_MS = 180000;
+
+// Binary serial protocol: largest decoded frame, and a UART RX buffer deep
+// enough to ride out a busy loop task at 115200 baud.
+static const size_t PROTO_MAX_FRAME = 512;
+static const size_t SERIAL_RX_BUFFER = 2048;
+// Longest log line (see beepr_log.h), on the logging task's stack. Fits a
+// full-length message line.
+static const size_t LOG_LINE_MAX = 256;
+
+// Runtime profiler (see beepr_profiler.h): sample period and warn thresholds.
+static const uint32_t PROFILER_SAMPLE_MS = 30000;
+static const uint32_t PROFILER_STACK_WARN_BYTES = 512;
+static const uint32_t PROFILER_HEAP_WARN_BYTES = 16384;
+static const uint8_t PROFILER_FRAG_WARN_PERCENT = 60;
+
+// Flight recorder ring in RTC slow memory, 8 bytes per event (power of two).
+static const uint32_t FLIGHTREC_RECORDS = 128;
+
+// Synthetic notifications injected at boot to measure lane latency (0 = off).
+static const uint16_t STORM_TEST_EVENTS = 0;
+
 // I2C pins for OLED.
 static const int I2C_SDA = 21;
 static const int I2C_SCL = 22;
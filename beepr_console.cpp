@@ -0,0 +1,197 @@
+#include "beepr_console.h"
+#include "beepr_alert.h"
+#include "beepr_ble.h"
+#include "beepr_display.h"
+#include "beepr_events.h"
+#include "beepr_filter.h"
+#include "beepr_flightrec.h"
+#include "beepr_notifs.h"
+#include "beepr_power.h"
+#include "beepr_proto.h"
+#include "beepr_profiler.h"
+
+#include <Arduino.h>
+
+static char lineBuffer[192];
+static size_t lineLength = 0;
+static bool lineOverflow = false;
+// Text never contains 0x00, so the first one means a host is speaking the
+// binary protocol; it stays in that mode until reset.
+static bool binaryMode = false;
+static TaskHandle_t readerTask = nullptr;
+
+static bool commandIs(const char *line, const char *command, const char **args)
+{
+    size_t len = strlen(command);
+    if (strncmp(line, command, len) != 0 || (line[len] != '\0' && line[len] != ' '))
+    {
+        return false;
+    }
+    const char *rest = line + len;
+    while (*rest == ' ')
+    {
+        rest++;
+    }
+    *args = rest;
+    return true;
+}
+
+static void handleCommand(const char *line)
+{
+    const char *args = nullptr;
+    if (commandIs(line, "prof", &args))
+    {
+        BeeprProfiler::print();
+    }
+    else if (commandIs(line, "alert", &args))
+    {
+        int pattern = atoi(args);
+        if (pattern > 0 && pattern < BeeprAlert::patternCount())
+        {
+            BeeprAlert::play((uint8_t)pattern);
+        }
+        else
+        {
+            BeeprAlert::printStats();
+        }
+    }
+    else if (commandIs(line, "ble", &args))
+    {
+        BeeprBle::printStats();
+    }
+    else if (commandIs(line, "flight", &args))
+    {
+        BeeprFlightRec::dump();
+    }
+    else if (commandIs(line, "lanes", &args))
+    {
+        BeeprEvents::printStats();
+    }
+    else if (commandIs(line, "filter", &args))
+    {
+        if (*args && !BeeprFilter::saveRules(args))
+        {
+            Serial.println("Filter rules rejected");
+        }
+        BeeprFilter::printStats();
+    }
+    else if (commandIs(line, "napp", &args))
+    {
+        BeeprNotifs::nextApp();
+    }
+    else if (commandIs(line, "clearapp", &args))
+    {
+        BeeprNotifs::clearCurrentApp();
+    }
+    else if (commandIs(line, "store", &args))
+    {
+        BeeprNotifs::printStats();
+    }
+    else if (commandIs(line, "tier", &args))
+    {
+        BeeprNotifs::printTierStats();
+    }
+    else if (commandIs(line, "disp", &args))
+    {
+        if (strncmp(args, "bench", 5) == 0)
+        {
+            int frames = atoi(args + 5);
+            BeeprDisplay::benchCompose(frames > 0 ? (uint16_t)frames : 100);
+        }
+        else if (strcmp(args, "atlas") == 0)
+        {
+            BeeprDisplay::dumpAtlas();
+        }
+        else
+        {
+            BeeprDisplay::printStats();
+        }
+    }
+    else if (commandIs(line, "power", &args))
+    {
+        BeeprPower::printStats();
+    }
+    else if (commandIs(line, "bench", &args))
+    {
+        int iterations = atoi(args);
+        BeeprNotifs::runContentionBench(iterations > 0 ? (uint16_t)iterations : 200);
+    }
+    else if (commandIs(line, "storm", &args))
+    {
+        int count = atoi(args);
+        BeeprEvents::injectStorm(count > 0 ? (uint16_t)count : 100);
+    }
+    else if (line[0] != '\0')
+    {
+        Serial.printf("Unknown command: %s\n", line);
+    }
+}
+
+void BeeprConsole::attachTask(TaskHandle_t task)
+{
+    readerTask = task;
+    // Runs on the UART event task at the RX FIFO threshold or after a short
+    // gap in the input.
+    Serial.onReceive([]() {
+        if (readerTask)
+        {
+            xTaskNotifyGive(readerTask);
+        }
+    });
+}
+
+void BeeprConsole::update()
+{
+    if (!binaryMode && Serial.available() > 0)
+    {
+        BeeprPower::noteConsole();
+    }
+    while (Serial.available() > 0)
+    {
+        int c = Serial.read();
+        if (c < 0)
+        {
+            break;
+        }
+        if (!binaryMode && c == 0)
+        {
+            binaryMode = true;
+            lineLength = 0;
+            lineOverflow = false;
+            BeeprPower::keepAwake();
+            Serial.println("Binary protocol mode");
+        }
+        if (binaryMode)
+        {
+            BeeprProto::feed((uint8_t)c);
+            continue;
+        }
+        if (c == '\r')
+        {
+            continue;
+        }
+        if (c == '\n')
+        {
+            lineBuffer[lineLength] = '\0';
+            if (lineOverflow)
+            {
+                Serial.println("Command too long");
+            }
+            else
+            {
+                handleCommand(lineBuffer);
+            }
+            lineLength = 0;
+            lineOverflow = false;
+            continue;
+        }
+        if (lineLength + 1 < sizeof(lineBuffer))
+        {
+            lineBuffer[lineLength++] = (char)c;
+        }
+        else
+        {
+            lineOverflow = true;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef BEEPR_CONSOLE_H
+#define BEEPR_CONSOLE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Line-based serial commands (115200 baud, newline terminated):
+//   prof              task stacks, CPU share, heap and queue high-water marks
+//   alert             alert counters and patterns
+//   alert <n>         play alert pattern n
+//   ble               reconnect to first notification timing
+//   flight            dump the flight recorder ring (tools/flightrec_decode.py)
+//   lanes             pending event lane counters
+//   filter            filter rules and hit counters
+//   filter <rules>    replace and persist filter rules (';' separated)
+//   napp              jump to the newest notification of the next app
+//   clearapp          clear every notification from the current app
+//   store             store lock waits, view costs, suppressed duplicates
+//   tier              record tiers (internal/PSRAM) use and copy cost
+//   disp              display frame counters, marquee fps and timings
+//   disp bench [n]    full-frame compose time, u8g2 text vs. glyph atlas
+//   disp atlas        glyph atlas as a C initializer (for FramebufferPanel)
+//   power             sleep modes, display residency and wake sources
+//   bench <count>     store contention bench (writer vs. pager tasks)
+//   storm <count>     inject synthetic notifications into the event lanes
+// A 0x00 byte switches the port to the binary protocol (beepr_proto.h) until
+// reset.
+namespace BeeprConsole
+{
+    // Wakes the task whenever UART input arrives, so it can block otherwise.
+    void attachTask(TaskHandle_t task);
+    void update();
+}
+
+#endif
@@ -1,65 +1,501 @@
 #include "beepr_display.h"
 #include "beepr_config.h"
+#include "beepr_log.h"
+
+#if BEEPR_HAS_DISPLAY
+#include "beepr_display_compose.h"
+#include "beepr_events.h"
+#include "beepr_flightrec.h"
+#include "beepr_panel_u8g2.h"
+#include "beepr_profiler.h"
 
 #include <Wire.h>
-#include <U8g2lib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#if BEEPR_PANEL == BEEPR_PANEL_SSD1306
+typedef Ssd1306Panel Panel;
+#else
+typedef Sh1106Panel Panel;
+#endif
+
+static Panel panel;
+
+static const int16_t PANEL_WIDTH = Panel::WIDTH;
+static const int16_t GLYPH_WIDTH = GLYPH_ATLAS_WIDTH; // u8g2_font_6x12_tr is fixed width.
+static const uint8_t MARQUEE_GAP_CHARS = 4;
+
+enum MarqueeStep : uint8_t
+{
+    MarqueeStopped = 0,
+    MarqueePaused = 1,
+    MarqueeDrawn = 2
+};
+
+struct MarqueeStats
+{
+    uint32_t frames;
+    uint32_t pausedFrames;
+    uint32_t activeMs;
+    uint32_t composeUsTotal;
+    uint32_t composeUsMax;
+    uint32_t busUsTotal;
+    uint32_t busUsMax;
+};
+
+static SemaphoreHandle_t panelMutex = nullptr;
+static TaskHandle_t marqueeTaskHandle = nullptr;
+
+static uint32_t lastFrameHash = 0;
+static bool lastFrameValid = false;
+static uint32_t framesSent = 0;
+static uint32_t framesSuppressed = 0;
+
+// Marquee state, guarded by panelMutex.
+static char marqueeText[NOTIF_MESSAGE_LEN];
+static int16_t marqueeWidth = 0;   // Text plus gap, in pixels.
+static int16_t marqueeOffset = 0;
+static uint32_t marqueeHoldUntilMs = 0;
+static bool marqueeActive = false;
+static bool marqueeResumeOnWake = false;
+static bool panelPowerSave = false;
+static MarqueeStats marqueeStats = {};
+
+// Header age of the notification on screen, guarded by panelMutex. Empty
+// while a status screen is up.
+static char shownAge[AGE_MAX_CHARS + 1] = "";
+static uint32_t ageRedraws = 0;
+
+// u8g2_font_6x12_tr decoded once at boot; text then goes straight into the
+// framebuffer. Without it (font too big) the panel falls back to drawStr().
+static GlyphAtlas atlas;
+
+static uint32_t composeFrames = 0;
+static uint32_t composeUsTotal = 0;
+static uint32_t composeUsMax = 0;
+
+static void lockPanel()
+{
+    if (panelMutex)
+    {
+        xSemaphoreTake(panelMutex, portMAX_DELAY);
+    }
+}
+
+static void unlockPanel()
+{
+    if (panelMutex)
+    {
+        xSemaphoreGive(panelMutex);
+    }
+}
+
+// Sends the composed frame unless it is identical to the one on the panel.
+// Hashing 1 KB costs a few microseconds; the I2C transfer it saves ~25 ms.
+static void sendFrame()
+{
+    const uint8_t *buffer = panel.frame();
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < Panel::frameBytes(); i += 4)
+    {
+        // The u8g2 buffer has no alignment guarantee; memcpy keeps loads legal.
+        uint32_t word;
+        memcpy(&word, buffer + i, sizeof(word));
+        hash ^= word;
+        hash *= 16777619UL;
+    }
+
+    if (lastFrameValid && hash == lastFrameHash)
+    {
+        framesSuppressed++;
+        return;
+    }
+    panel.transfer();
+    lastFrameHash = hash;
+    lastFrameValid = true;
+    framesSent++;
+}
+
+static void noteComposeTime(bool notification, uint32_t us)
+{
+    BeeprFlightRec::record(FlightRender, notification ? 1 : 0, (uint16_t)(us > 0xFFFF ? 0xFFFF : us));
+    composeFrames++;
+    composeUsTotal += us;
+    if (us > composeUsMax)
+    {
+        composeUsMax = us;
+    }
+}
+
+static void drawMessageBand()
+{
+    composeMessageBand(panel, marqueeText, strlen(marqueeText), marqueeOffset, marqueeWidth);
+}
+
+static void stopMarqueeLocked()
+{
+    marqueeActive = false;
+    marqueeResumeOnWake = false;
+}
+
+static void startMarqueeLocked(const char *message)
+{
+    size_t len = strlen(message);
+    if ((int16_t)(len * GLYPH_WIDTH) <= PANEL_WIDTH - TEXT_LEFT)
+    {
+        stopMarqueeLocked();
+        return;
+    }
+
+    strncpy(marqueeText, message, sizeof(marqueeText) - 1);
+    marqueeText[sizeof(marqueeText) - 1] = '\0';
+    marqueeWidth = (int16_t)((strlen(marqueeText) + MARQUEE_GAP_CHARS) * GLYPH_WIDTH);
+    marqueeOffset = 0;
+    marqueeHoldUntilMs = millis() + MARQUEE_START_HOLD_MS;
+    if (panelPowerSave)
+    {
+        marqueeResumeOnWake = true;
+        return;
+    }
+    marqueeActive = true;
+    if (marqueeTaskHandle)
+    {
+        xTaskNotifyGive(marqueeTaskHandle);
+    }
+}
+
+static bool bleBurstInProgress()
+{
+    return BeeprEvents::pendingCount() > 0 || BeeprEvents::msSinceLastEnqueue() < MARQUEE_BURST_HOLD_MS;
+}
+
+// Advances and pushes one marquee frame.
+static MarqueeStep marqueeFrame()
+{
+    lockPanel();
+    if (!marqueeActive)
+    {
+        unlockPanel();
+        return MarqueeStopped;
+    }
+
+    uint32_t now = millis();
+    if ((int32_t)(now - marqueeHoldUntilMs) < 0 || bleBurstInProgress())
+    {
+        // Hold at the start of each pass, and stay off the CPU and bus while
+        // notifications are pouring in.
+        marqueeStats.pausedFrames++;
+        unlockPanel();
+        return MarqueePaused;
+    }
 
-static U8G2_SH1106_128X64_NONAME_F_HW_I2C oled(U8G2_R0, U8X8_PIN_NONE);
+    uint32_t t0 = micros();
+    marqueeOffset++;
+    if (marqueeOffset >= marqueeWidth)
+    {
+        marqueeOffset = 0;
+        marqueeHoldUntilMs = now + MARQUEE_START_HOLD_MS;
+    }
+    drawMessageBand();
+    uint32_t t1 = micros();
+    panel.transferRows(MESSAGE_TILE_ROW, MESSAGE_TILE_ROWS);
+    uint32_t t2 = micros();
+    // The panel no longer matches the last full-frame hash.
+    lastFrameValid = false;
+
+    uint32_t composeUs = t1 - t0;
+    uint32_t busUs = t2 - t1;
+    marqueeStats.frames++;
+    marqueeStats.composeUsTotal += composeUs;
+    marqueeStats.busUsTotal += busUs;
+    if (composeUs > marqueeStats.composeUsMax)
+    {
+        marqueeStats.composeUsMax = composeUs;
+    }
+    if (busUs > marqueeStats.busUsMax)
+    {
+        marqueeStats.busUsMax = busUs;
+    }
+    unlockPanel();
+    return MarqueeDrawn;
+}
+
+// Fixed-rate frame scheduler: ticks at MARQUEE_FPS only while a long message
+// is on screen, otherwise blocks without any wakeups until the next one.
+static void marqueeTask(void *param)
+{
+    (void)param;
+    const TickType_t period = pdMS_TO_TICKS(1000 / MARQUEE_FPS);
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        TickType_t lastTick = xTaskGetTickCount();
+        TickType_t nextTick = lastTick + period;
+        MarqueeStep step;
+        while ((step = marqueeFrame()) != MarqueeStopped)
+        {
+            TickType_t now = xTaskGetTickCount();
+            if (step == MarqueeDrawn)
+            {
+                // Only time spent scrolling counts towards the achieved fps.
+                marqueeStats.activeMs += (now - lastTick) * portTICK_PERIOD_MS;
+            }
+            lastTick = now;
+            if ((int32_t)(nextTick - now) <= 0)
+            {
+                // Overran a frame: resync instead of bursting to catch up.
+                nextTick = now + period;
+            }
+            // A restart notification cuts the wait short.
+            ulTaskNotifyTake(pdTRUE, nextTick - now);
+            nextTick += period;
+        }
+    }
+}
 
 void BeeprDisplay::begin()
 {
     Wire.begin(I2C_SDA, I2C_SCL);
-    oled.begin();
+    panel.begin();
+    if (panel.decodeGlyphs(atlas))
+    {
+        panel.setAtlas(&atlas);
+    }
+    else
+    {
+        BEEPR_LOGW("Display: font does not fit the glyph atlas, using u8g2 text\n");
+    }
+    panelMutex = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(marqueeTask, "beepr_marquee", MARQUEE_TASK_STACK, nullptr, 1, &marqueeTaskHandle, 1);
+    BeeprProfiler::watchTask(marqueeTaskHandle, MARQUEE_TASK_STACK);
     showStatus("Beeper", "Starting...");
 }
 
-void BeeprDisplay::showStatus(const String &line1, const String &line2)
+void BeeprDisplay::showStatus(const char *line1, const char *line2)
+{
+    lockPanel();
+    stopMarqueeLocked();
+    shownAge[0] = '\0';
+    uint32_t t0 = micros();
+    composeStatus(panel, line1, line2);
+    noteComposeTime(false, micros() - t0);
+    sendFrame();
+    unlockPanel();
+}
+
+void BeeprDisplay::showNotification(const char *appName, const char *contact, const char *message,
+                                    size_t appCount, size_t currentIndex, size_t totalCount, uint32_t ageMs)
+{
+    lockPanel();
+    formatAge(shownAge, sizeof(shownAge), ageMs);
+    uint32_t t0 = micros();
+    composeNotification(panel, appName, contact, message, appCount, currentIndex, totalCount, shownAge);
+    noteComposeTime(true, micros() - t0);
+    sendFrame();
+    startMarqueeLocked(message);
+    unlockPanel();
+}
+
+void BeeprDisplay::showEmpty()
+{
+    showStatus("No", "Notifications");
+}
+
+uint32_t BeeprDisplay::refreshAge(uint32_t ageMs)
+{
+    lockPanel();
+    if (shownAge[0] == '\0')
+    {
+        unlockPanel();
+        return AGE_NOT_SHOWN;
+    }
+    char age[sizeof(shownAge)];
+    formatAge(age, sizeof(age), ageMs);
+    if (strcmp(age, shownAge) != 0)
+    {
+        memcpy(shownAge, age, sizeof(shownAge));
+        composeAge(panel, shownAge);
+        panel.transferRows(HEADER_TILE_ROW, HEADER_TILE_ROWS);
+        // The panel no longer matches the last full-frame hash.
+        lastFrameValid = false;
+        ageRedraws++;
+    }
+    unlockPanel();
+    return ageTextValidMs(ageMs);
+}
+
+void BeeprDisplay::setPowerSave(bool enable)
 {
-    oled.clearBuffer();
-    oled.setFont(u8g2_font_6x12_tr);
-    oled.drawStr(2, 12, line1.c_str());
-    oled.drawStr(2, 28, line2.c_str());
-    oled.setDrawColor(0);
-    oled.drawBox(0, 0, 2, 64);
-    oled.setDrawColor(1);
-    oled.sendBuffer();
+    lockPanel();
+    if (enable != panelPowerSave)
+    {
+        panelPowerSave = enable;
+        panel.powerSave(enable);
+        if (enable)
+        {
+            // No point scrolling a dark panel; pick up where it left off.
+            marqueeResumeOnWake = marqueeActive;
+            marqueeActive = false;
+        }
+        else if (marqueeResumeOnWake)
+        {
+            marqueeResumeOnWake = false;
+            marqueeHoldUntilMs = millis() + MARQUEE_START_HOLD_MS;
+            marqueeActive = true;
+            if (marqueeTaskHandle)
+            {
+                xTaskNotifyGive(marqueeTaskHandle);
+            }
+        }
+    }
+    unlockPanel();
 }
 
-void BeeprDisplay::showNotification(const String &appName, const String &contact, const String &message,
-                                    size_t currentIndex, size_t totalCount)
+void BeeprDisplay::benchCompose(uint16_t frames)
 {
-    oled.clearBuffer();
-    oled.setFont(u8g2_font_6x12_tr);
-    oled.drawStr(2, 26, appName.c_str());
-    oled.drawStr(2, 40, contact.c_str());
-    if (message.length())
+    static const char *app = "Messages (3)";
+    static const char *contact = "Alice Appleseed";
+    static const char *message = "Running late, see you at the station at 7!";
+
+    const size_t frameBytes = Panel::frameBytes();
+    uint8_t *saved = (uint8_t *)malloc(frameBytes);
+    uint8_t *reference = (uint8_t *)malloc(frameBytes);
+    if (!saved || !reference)
     {
-        oled.drawStr(2, 54, message.c_str());
+        free(saved);
+        free(reference);
+        Serial.println("Display bench: out of memory");
+        return;
     }
-    if (totalCount > 0)
+
+    lockPanel();
+    memcpy(saved, panel.frame(), frameBytes);
+    const GlyphAtlas *useAtlas = panel.atlas();
+    uint32_t us[2];
+    for (uint8_t pass = 0; pass < 2; pass++)
     {
-        size_t shownIndex = currentIndex;
-        if (shownIndex >= totalCount)
+        // Pass 0 is the u8g2 decoder, pass 1 the atlas.
+        panel.setAtlas(pass == 1 ? useAtlas : nullptr);
+        uint32_t t0 = micros();
+        for (uint16_t i = 0; i < frames; i++)
         {
-            shownIndex = totalCount - 1;
+            composeNotification(panel, app, contact, message, 1, 2, 12, "5m");
         }
-        char counter[16];
-        snprintf(counter, sizeof(counter), "%u/%u",
-                 (unsigned)(shownIndex + 1), (unsigned)totalCount);
-        int16_t x = 128 - oled.getStrWidth(counter) - 2;
-        if (x < 2)
+        us[pass] = micros() - t0;
+        if (pass == 0)
         {
-            x = 2;
+            memcpy(reference, panel.frame(), frameBytes);
         }
-        oled.drawStr(x, 12, counter);
     }
-    oled.setDrawColor(0);
-    oled.drawBox(0, 0, 2, 64);
-    oled.setDrawColor(1);
-    oled.sendBuffer();
+    bool identical = memcmp(reference, panel.frame(), frameBytes) == 0;
+    panel.setAtlas(useAtlas);
+    memcpy(panel.frame(), saved, frameBytes);
+    unlockPanel();
+    free(saved);
+    free(reference);
+
+    if (!useAtlas)
+    {
+        Serial.println("Display bench: glyph atlas not in use");
+        return;
+    }
+    Serial.printf("Display bench: %u frames, u8g2 %luus/frame, atlas %luus/frame, output %s\n", (unsigned)frames,
+                  (unsigned long)(us[0] / frames), (unsigned long)(us[1] / frames),
+                  identical ? "identical" : "DIFFERS");
+}
+
+void BeeprDisplay::dumpAtlas()
+{
+    if (!panel.atlas())
+    {
+        Serial.println("Display: glyph atlas not in use");
+        return;
+    }
+    // Pasteable into a host build that renders through FramebufferPanel.
+    Serial.println("static const GlyphAtlas beeprAtlas6x12 = {{");
+    for (uint8_t i = 0; i < GLYPH_ATLAS_COUNT; i++)
+    {
+        const uint16_t *c = atlas.columns[i];
+        Serial.printf("    {0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x}, // 0x%02x\n", c[0], c[1], c[2], c[3],
+                      c[4], c[5], (unsigned)(GLYPH_ATLAS_FIRST + i));
+    }
+    Serial.println("}};");
+}
+
+void BeeprDisplay::printStats()
+{
+    Serial.printf("Display: frames sent=%lu suppressed=%lu, age redraws=%lu\n",
+                  (unsigned long)framesSent, (unsigned long)framesSuppressed, (unsigned long)ageRedraws);
+    Serial.printf("Display: full-frame compose avg=%luus max=%luus (%s text)\n",
+                  (unsigned long)(composeFrames ? composeUsTotal / composeFrames : 0),
+                  (unsigned long)composeUsMax, panel.atlas() ? "atlas" : "u8g2");
+
+    const MarqueeStats &s = marqueeStats;
+    uint32_t fpsX10 = s.activeMs ? (uint32_t)((uint64_t)s.frames * 10000 / s.activeMs) : 0;
+    uint32_t composeAvg = s.frames ? s.composeUsTotal / s.frames : 0;
+    uint32_t busAvg = s.frames ? s.busUsTotal / s.frames : 0;
+    Serial.printf("Marquee: frames=%lu paused=%lu fps=%lu.%lu (target %u)\n",
+                  (unsigned long)s.frames, (unsigned long)s.pausedFrames,
+                  (unsigned long)(fpsX10 / 10), (unsigned long)(fpsX10 % 10), (unsigned)MARQUEE_FPS);
+    Serial.printf("Marquee: compose avg=%luus max=%luus, bus avg=%luus max=%luus\n",
+                  (unsigned long)composeAvg, (unsigned long)s.composeUsMax,
+                  (unsigned long)busAvg, (unsigned long)s.busUsMax);
+}
+
+#else // Headless: status lines go to the log, everything else is a no-op.
+
+void BeeprDisplay::begin()
+{
+}
+
+void BeeprDisplay::showStatus(const char *line1, const char *line2)
+{
+    BEEPR_LOGI("Status: %s %s\n", line1, line2);
+}
+
+void BeeprDisplay::showNotification(const char *appName, const char *contact, const char *message,
+                                    size_t appCount, size_t currentIndex, size_t totalCount, uint32_t ageMs)
+{
+    (void)appName;
+    (void)contact;
+    (void)message;
+    (void)appCount;
+    (void)currentIndex;
+    (void)totalCount;
+    (void)ageMs;
 }
 
 void BeeprDisplay::showEmpty()
 {
-    showStatus("No", "Notifications");
 }
+
+uint32_t BeeprDisplay::refreshAge(uint32_t ageMs)
+{
+    (void)ageMs;
+    return 0xFFFFFFFFUL;
+}
+
+void BeeprDisplay::setPowerSave(bool enable)
+{
+    (void)enable;
+}
+
+void BeeprDisplay::benchCompose(uint16_t frames)
+{
+    (void)frames;
+    Serial.println("Display: headless build");
+}
+
+void BeeprDisplay::dumpAtlas()
+{
+    Serial.println("Display: headless build");
+}
+
+void BeeprDisplay::printStats()
+{
+    Serial.println("Display: headless build");
+}
+
+#endif
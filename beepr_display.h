@@ -6,10 +6,22 @@
 namespace BeeprDisplay
 {
     void begin();
-    void showStatus(const String &line1, const String &line2);
-    void showNotification(const String &appName, const String &contact, const String &message,
-                          size_t currentIndex, size_t totalCount);
+    void showStatus(const char *line1, const char *line2);
+    void showNotification(const char *appName, const char *contact, const char *message,
+                          size_t appCount, size_t currentIndex, size_t totalCount, uint32_t ageMs);
+    // Redraws only the header age of the notification on screen, and only
+    // if its text changed. Returns ms until the text next changes, or
+    // 0xFFFFFFFF when nothing on screen shows an age.
+    uint32_t refreshAge(uint32_t ageMs);
     void showEmpty();
+    // Panel RAM is kept in power-save, so waking needs no redraw.
+    void setPowerSave(bool enable);
+    // Composes a sample notification frames times with u8g2 text and with
+    // the glyph atlas, without touching the panel.
+    void benchCompose(uint16_t frames);
+    // Prints the decoded glyph atlas as a C initializer for host renders.
+    void dumpAtlas();
+    void printStats();
 }
 
 #endif
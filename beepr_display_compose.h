@@ -0,0 +1,155 @@
+#ifndef BEEPR_DISPLAY_COMPOSE_H
+#define BEEPR_DISPLAY_COMPOSE_H
+
+#include <stdio.h>
+#include "beepr_panel.h"
+
+// Screen layouts, composed into any panel's framebuffer. Templates over the
+// backend so they inline into it; no Arduino dependencies, so the same code
+// renders into a FramebufferPanel on a host.
+
+static const int16_t TEXT_LEFT = 2;
+static const int16_t MESSAGE_BASELINE = 60;
+// The message line sits entirely in tile rows 6-7 (y 48..63), so a scroll
+// step only has to redraw and transfer those two rows.
+static const uint8_t MESSAGE_TILE_ROW = 6;
+static const uint8_t MESSAGE_TILE_ROWS = 2;
+// The header (age left, pager counter right) is tile rows 0-1; an age change
+// redraws only the age box and transfers those two rows.
+static const int16_t HEADER_BASELINE = 12;
+static const uint8_t HEADER_TILE_ROW = 0;
+static const uint8_t HEADER_TILE_ROWS = 2;
+static const uint8_t AGE_MAX_CHARS = 3;
+static const uint32_t AGE_NOT_SHOWN = 0xFFFFFFFFUL;
+
+// Relative age for the header: "now" for the first minute, then whole
+// minutes, hours and days ("5m", "3h", "2d"). A millis() age stays
+// under 50 days, so the text never exceeds AGE_MAX_CHARS.
+static inline void formatAge(char *out, size_t size, uint32_t ageMs)
+{
+    uint32_t minutes = ageMs / 60000UL;
+    if (minutes == 0)
+    {
+        snprintf(out, size, "now");
+    }
+    else if (minutes < 60)
+    {
+        snprintf(out, size, "%lum", (unsigned long)minutes);
+    }
+    else if (minutes < 24 * 60)
+    {
+        snprintf(out, size, "%luh", (unsigned long)(minutes / 60));
+    }
+    else
+    {
+        snprintf(out, size, "%lud", (unsigned long)(minutes / (24 * 60)));
+    }
+}
+
+// Milliseconds until formatAge() gives a different text.
+static inline uint32_t ageTextValidMs(uint32_t ageMs)
+{
+    uint32_t unitMs = 60000UL;
+    if (ageMs >= 24 * 3600000UL)
+    {
+        unitMs = 24 * 3600000UL;
+    }
+    else if (ageMs >= 3600000UL)
+    {
+        unitMs = 3600000UL;
+    }
+    return unitMs - ageMs % unitMs;
+}
+
+template <class Panel>
+static void clearLeftMargin(BeeprPanel<Panel> &panel)
+{
+    panel.clearBox(0, 0, TEXT_LEFT, Panel::HEIGHT);
+}
+
+template <class Panel>
+static void composeStatus(BeeprPanel<Panel> &panel, const char *line1, const char *line2)
+{
+    panel.clear();
+    panel.drawText(TEXT_LEFT, 12, line1);
+    panel.drawText(TEXT_LEFT, 28, line2);
+    clearLeftMargin(panel);
+}
+
+// Redraws the age box at the left of the header.
+template <class Panel>
+static void composeAge(BeeprPanel<Panel> &panel, const char *age)
+{
+    panel.clearBox(0, HEADER_TILE_ROW * 8, TEXT_LEFT + AGE_MAX_CHARS * GLYPH_ATLAS_WIDTH, HEADER_TILE_ROWS * 8);
+    panel.drawText(TEXT_LEFT, HEADER_BASELINE, age);
+    clearLeftMargin(panel);
+}
+
+template <class Panel>
+static void composeNotification(BeeprPanel<Panel> &panel, const char *appName, const char *contact,
+                                const char *message, size_t appCount, size_t currentIndex, size_t totalCount,
+                                const char *age)
+{
+    panel.clear();
+    panel.drawText(TEXT_LEFT, HEADER_BASELINE, age);
+    if (appCount > 1)
+    {
+        // Grouped count comes from the store's per-app index, no scan needed.
+        // Anything past the panel's width is clipped anyway.
+        char appLine[Panel::WIDTH / GLYPH_ATLAS_WIDTH + 8];
+        snprintf(appLine, sizeof(appLine), "%s (%u)", appName, (unsigned)appCount);
+        panel.drawText(TEXT_LEFT, 26, appLine);
+    }
+    else
+    {
+        panel.drawText(TEXT_LEFT, 26, appName);
+    }
+    panel.drawText(TEXT_LEFT, 40, contact);
+    if (message[0])
+    {
+        panel.drawText(TEXT_LEFT, MESSAGE_BASELINE, message);
+    }
+    if (totalCount > 0)
+    {
+        size_t shownIndex = currentIndex;
+        if (shownIndex >= totalCount)
+        {
+            shownIndex = totalCount - 1;
+        }
+        char counter[16];
+        snprintf(counter, sizeof(counter), "%u/%u", (unsigned)(shownIndex + 1), (unsigned)totalCount);
+        int16_t x = Panel::WIDTH - panel.textWidth(counter) - 2;
+        if (x < TEXT_LEFT)
+        {
+            x = TEXT_LEFT;
+        }
+        panel.drawText(x, HEADER_BASELINE, counter);
+    }
+    clearLeftMargin(panel);
+}
+
+// Redraws the message band scrolled by offset pixels; width is the text plus
+// the gap before its wrapped copy.
+template <class Panel>
+static void composeMessageBand(BeeprPanel<Panel> &panel, const char *text, size_t textLen, int16_t offset,
+                               int16_t width)
+{
+    panel.clearBox(0, MESSAGE_TILE_ROW * 8, Panel::WIDTH, MESSAGE_TILE_ROWS * 8);
+
+    // Whole characters scrolled off the left are skipped, so the first glyph
+    // starts at most one glyph left of the margin.
+    int16_t skipChars = offset / GLYPH_ATLAS_WIDTH;
+    int16_t x = TEXT_LEFT - offset % GLYPH_ATLAS_WIDTH;
+    if (skipChars < (int16_t)textLen)
+    {
+        panel.drawText(x, MESSAGE_BASELINE, text + skipChars);
+    }
+    int16_t wrapX = TEXT_LEFT - offset + width;
+    if (wrapX < Panel::WIDTH)
+    {
+        panel.drawText(wrapX, MESSAGE_BASELINE, text);
+    }
+    clearLeftMargin(panel);
+}
+
+#endif
@@ -0,0 +1,561 @@
+#include "beepr_events.h"
+#include "beepr_config.h"
+#include "beepr_flightrec.h"
+#include "beepr_log.h"
+#include "beepr_notifs.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "esp_heap_caps.h"
+
+enum LaneDropPolicy : uint8_t
+{
+    DropOldest = 0, // Evict the oldest queued event so fresh ones keep flowing.
+    DropNewest = 1  // Keep what is queued and reject the incoming event.
+};
+
+struct LaneConfig
+{
+    const char *name;
+    uint8_t depth;
+    LaneDropPolicy policy;
+    uint16_t backlog; // PSRAM overflow depth, used only when PSRAM exists.
+};
+
+static const LaneConfig laneConfigs[EventLaneCount] = {
+    // The newest call state is what matters, so no backlog either.
+    {"urgent", EVENT_LANE_URGENT_DEPTH, DropOldest, 0},
+    // Earliest reminders/emails are the most time critical, keep them.
+    {"high", EVENT_LANE_HIGH_DEPTH, DropNewest, EVENT_BACKLOG_HIGH},
+    // Bulk traffic: drop oldest, so fresh events keep flowing.
+    {"bulk", EVENT_LANE_BULK_DEPTH, DropOldest, EVENT_BACKLOG_BULK},
+};
+
+// Overflow ring behind a lane's queue. Once anything is backlogged, new events
+// go to the backlog too and the consumer drains the queue first, so each lane
+// stays FIFO.
+struct LaneBacklog
+{
+    PendingNotifEvent *events;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t count;
+};
+
+static QueueHandle_t laneQueues[EventLaneCount] = {nullptr, nullptr, nullptr};
+static EventLaneStats laneStats[EventLaneCount] = {};
+static volatile bool statsPendingAfterDrain = false;
+static volatile uint32_t lastEnqueueMs = 0;
+static LaneBacklog backlogs[EventLaneCount] = {};
+static portMUX_TYPE backlogMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t consumerTask = nullptr;
+
+// A lost remove would leave its entry in the store until it expires, so
+// removes are exempt from the drop policies. One that finds its lane full, or
+// is evicted from it, is parked here instead with its mark: how many events
+// had entered the lane ahead of it. It is handed out once that many have left
+// the lane, so it never overtakes the add it removes. Parking never waits;
+// the ring covers a remove for every stored entry and every queued event, and
+// a remove beyond that is counted as lost and left to expire.
+struct ParkedRemove
+{
+    uint32_t uid;
+    uint32_t mark;
+    NotificationCategory category;
+    bool entered; // Evicted from the lane: counts as leaving it when handed out.
+};
+
+struct ParkedRemoves
+{
+    ParkedRemove *slots;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t count;
+};
+
+static const uint16_t PARK_POOL_SIZE =
+    3 * NOTIF_STORE_CAPACITY + EVENT_LANE_URGENT_DEPTH + EVENT_LANE_HIGH_DEPTH + EVENT_LANE_BULK_DEPTH;
+static ParkedRemove parkPool[PARK_POOL_SIZE];
+static ParkedRemoves parked[EventLaneCount] = {};
+static uint32_t laneEntered[EventLaneCount] = {}; // Queued or backlogged.
+static uint32_t laneLeft[EventLaneCount] = {};    // Dequeued or evicted.
+static volatile bool removesLostPending = false;
+
+static void statAdd(uint32_t &counter)
+{
+    __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+}
+
+static void statMax(uint32_t &counter, uint32_t value)
+{
+    uint32_t seen = __atomic_load_n(&counter, __ATOMIC_RELAXED);
+    while (value > seen &&
+           !__atomic_compare_exchange_n(&counter, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+// Parks a remove that has no room in its lane, kept in mark order: an evicted
+// one can be older than removes parked since it entered. Returns false, and
+// counts the remove as lost, if the ring is full.
+static bool parkRemove(EventLane lane, const PendingNotifEvent &event, bool entered)
+{
+    ParkedRemoves &p = parked[lane];
+    bool ok = false;
+    portENTER_CRITICAL(&backlogMux);
+    if (p.count < p.capacity)
+    {
+        uint16_t at = p.count;
+        for (; at > 0; --at)
+        {
+            const ParkedRemove &prev = p.slots[(p.head + at - 1) % p.capacity];
+            if ((int32_t)(event.laneMark - prev.mark) >= 0)
+            {
+                break;
+            }
+            p.slots[(p.head + at) % p.capacity] = prev;
+        }
+        ParkedRemove &slot = p.slots[(p.head + at) % p.capacity];
+        slot.uid = event.uid;
+        slot.mark = event.laneMark;
+        slot.category = event.category;
+        slot.entered = entered;
+        p.count++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&backlogMux);
+    if (ok)
+    {
+        statAdd(laneStats[lane].removesParked);
+    }
+    else
+    {
+        statAdd(laneStats[lane].dropped);
+        statAdd(laneStats[lane].removesLost);
+        removesLostPending = true;
+    }
+    return ok;
+}
+
+// Hands out the oldest parked remove once everything ahead of it has left
+// the lane.
+static bool takeParkedRemove(EventLane lane, PendingNotifEvent &event)
+{
+    ParkedRemoves &p = parked[lane];
+    bool got = false;
+    portENTER_CRITICAL(&backlogMux);
+    if (p.count > 0 && (int32_t)(__atomic_load_n(&laneLeft[lane], __ATOMIC_RELAXED) - p.slots[p.head].mark) >= 0)
+    {
+        const ParkedRemove &slot = p.slots[p.head];
+        event = PendingNotifEvent();
+        event.type = PendingEventRemove;
+        event.uid = slot.uid;
+        event.category = slot.category;
+        event.record = NOTIF_NO_RECORD;
+        if (slot.entered)
+        {
+            statAdd(laneLeft[lane]);
+        }
+        p.head = (uint16_t)((p.head + 1) % p.capacity);
+        p.count--;
+        got = true;
+    }
+    portEXIT_CRITICAL(&backlogMux);
+    return got;
+}
+
+static uint16_t parkedCount(EventLane lane)
+{
+    portENTER_CRITICAL(&backlogMux);
+    uint16_t count = parked[lane].count;
+    portEXIT_CRITICAL(&backlogMux);
+    return count;
+}
+
+// Disposes of an event evicted from a lane by DropOldest: removes are parked
+// with the mark they entered the lane with, adds give up their record.
+static void evicted(EventLane lane, const PendingNotifEvent &event)
+{
+    if (event.type == PendingEventRemove && parkRemove(lane, event, true))
+    {
+        return;
+    }
+    statAdd(laneLeft[lane]);
+    BeeprNotifs::releaseRecord(event.record);
+}
+
+void BeeprEvents::begin()
+{
+    ParkedRemove *slots = parkPool;
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        if (!parked[lane].slots)
+        {
+            parked[lane].slots = slots;
+            parked[lane].capacity = (uint16_t)(NOTIF_STORE_CAPACITY + laneConfigs[lane].depth);
+        }
+        slots += NOTIF_STORE_CAPACITY + laneConfigs[lane].depth;
+
+        if (laneQueues[lane])
+        {
+            continue;
+        }
+        laneQueues[lane] = xQueueCreate(laneConfigs[lane].depth, sizeof(PendingNotifEvent));
+        if (!laneQueues[lane])
+        {
+            BEEPR_LOGE("Failed to create %s event lane\n", laneConfigs[lane].name);
+        }
+    }
+
+    // Backlogged events hold records, so backlogs only exist when the record
+    // pool has a PSRAM tier to back them.
+    if (BeeprNotifs::slowRecordCapacity() == 0)
+    {
+        return;
+    }
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        LaneBacklog &b = backlogs[lane];
+        if (b.events || laneConfigs[lane].backlog == 0)
+        {
+            continue;
+        }
+        b.events = (PendingNotifEvent *)heap_caps_calloc(laneConfigs[lane].backlog, sizeof(PendingNotifEvent),
+                                                         MALLOC_CAP_SPIRAM);
+        b.capacity = b.events ? laneConfigs[lane].backlog : 0;
+    }
+}
+
+void BeeprEvents::attachConsumer(TaskHandle_t task)
+{
+    consumerTask = task;
+}
+
+// Called with backlogMux held.
+static bool backlogPushLocked(LaneBacklog &b, const PendingNotifEvent &event)
+{
+    if (b.count >= b.capacity)
+    {
+        return false;
+    }
+    b.events[(b.head + b.count) % b.capacity] = event;
+    b.count++;
+    return true;
+}
+
+// Called with backlogMux held.
+static bool backlogPopLocked(LaneBacklog &b, PendingNotifEvent &event)
+{
+    if (b.count == 0)
+    {
+        return false;
+    }
+    event = b.events[b.head];
+    b.head = (uint16_t)((b.head + 1) % b.capacity);
+    b.count--;
+    return true;
+}
+
+// Queues behind a full (or already backlogged) lane. Returns false if the
+// event was rejected; an event evicted to make room is disposed of here.
+// Removes are never passed in with the backlog full.
+static bool spillToBacklog(EventLane lane, PendingNotifEvent &event, EventLaneStats &stats)
+{
+    LaneBacklog &b = backlogs[lane];
+    PendingNotifEvent oldest;
+    bool evict = false;
+    bool queued = false;
+    portENTER_CRITICAL(&backlogMux);
+    if (b.capacity > 0)
+    {
+        if (b.count >= b.capacity)
+        {
+            statAdd(stats.dropped);
+            evict = laneConfigs[lane].policy == DropOldest && backlogPopLocked(b, oldest);
+        }
+        queued = backlogPushLocked(b, event);
+        if (queued)
+        {
+            statAdd(stats.spilled);
+            statMax(stats.backlogHighWater, b.count);
+        }
+    }
+    portEXIT_CRITICAL(&backlogMux);
+    if (evict)
+    {
+        evicted(lane, oldest);
+    }
+    return queued;
+}
+
+static bool backlogFull(EventLane lane)
+{
+    portENTER_CRITICAL(&backlogMux);
+    bool full = backlogs[lane].count >= backlogs[lane].capacity;
+    portEXIT_CRITICAL(&backlogMux);
+    return full;
+}
+
+static uint16_t backlogCount(EventLane lane)
+{
+    portENTER_CRITICAL(&backlogMux);
+    uint16_t count = backlogs[lane].count;
+    portEXIT_CRITICAL(&backlogMux);
+    return count;
+}
+
+EventLane BeeprEvents::laneFor(NotificationCategory category)
+{
+    switch (category)
+    {
+    case CategoryIDIncomingCall:
+    case CategoryIDMissedCall:
+    case CategoryIDVoicemail:
+        return EventLaneUrgent;
+    case CategoryIDSchedule:
+    case CategoryIDEmail:
+        return EventLaneHigh;
+    default:
+        return EventLaneBulk;
+    }
+}
+
+bool BeeprEvents::enqueue(PendingNotifEvent &event)
+{
+    const EventLane lane = laneFor(event.category);
+    QueueHandle_t q = laneQueues[lane];
+    if (!q)
+    {
+        BeeprNotifs::releaseRecord(event.record);
+        return false;
+    }
+
+    EventLaneStats &stats = laneStats[lane];
+    event.enqueuedUs = micros();
+    event.laneMark = __atomic_load_n(&laneEntered[lane], __ATOMIC_RELAXED);
+    lastEnqueueMs = millis();
+    uint32_t droppedBefore = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED);
+    bool isRemove = event.type == PendingEventRemove;
+
+    bool queued = false;
+    bool parkedHere = false;
+    bool useBacklog = backlogs[lane].capacity > 0 && (backlogCount(lane) > 0 || uxQueueSpacesAvailable(q) == 0);
+    if (useBacklog && !(isRemove && backlogFull(lane)))
+    {
+        // PSRAM backlog: only drops once the backlog itself is full.
+        queued = spillToBacklog(lane, event, stats);
+    }
+    else if (!useBacklog)
+    {
+        queued = xQueueSend(q, &event, 0) == pdTRUE;
+        if (!queued && !isRemove)
+        {
+            statAdd(stats.dropped);
+            if (laneConfigs[lane].policy == DropOldest)
+            {
+                PendingNotifEvent oldest;
+                if (xQueueReceive(q, &oldest, 0) == pdTRUE)
+                {
+                    evicted(lane, oldest);
+                }
+                queued = xQueueSend(q, &event, 0) == pdTRUE;
+            }
+        }
+    }
+    if (!queued && isRemove)
+    {
+        parkedHere = parkRemove(lane, event, false);
+    }
+    uint32_t dropped = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED);
+    if (dropped != droppedBefore)
+    {
+        BeeprFlightRec::record(FlightDrop, lane, (uint16_t)dropped);
+    }
+    if (!queued && !parkedHere)
+    {
+        BeeprNotifs::releaseRecord(event.record);
+        return false;
+    }
+
+    if (queued)
+    {
+        statAdd(laneEntered[lane]);
+        statAdd(stats.enqueued);
+        uint32_t depth = uxQueueMessagesWaiting(q);
+        BeeprFlightRec::record(FlightEnqueue, lane, (uint16_t)(depth + backlogCount(lane)));
+        statMax(stats.highWater, depth);
+    }
+    if (consumerTask)
+    {
+        xTaskNotifyGive(consumerTask);
+    }
+    return true;
+}
+
+bool BeeprEvents::dequeue(PendingNotifEvent &event)
+{
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        if (!laneQueues[lane])
+        {
+            continue;
+        }
+        if (takeParkedRemove((EventLane)lane, event))
+        {
+            return true;
+        }
+        bool got = xQueueReceive(laneQueues[lane], &event, 0) == pdTRUE;
+        if (!got && backlogs[lane].capacity > 0)
+        {
+            portENTER_CRITICAL(&backlogMux);
+            got = backlogPopLocked(backlogs[lane], event);
+            portEXIT_CRITICAL(&backlogMux);
+        }
+        if (!got)
+        {
+            continue;
+        }
+
+        statAdd(laneLeft[lane]);
+        EventLaneStats &stats = laneStats[lane];
+        uint32_t latencyUs = micros() - event.enqueuedUs;
+        stats.dequeued++;
+        stats.latencyTotalUs += latencyUs;
+        if (latencyUs > stats.latencyMaxUs)
+        {
+            stats.latencyMaxUs = latencyUs;
+        }
+        return true;
+    }
+
+    // Lost removes leave their entries to the TTL wheel; say so once the lanes
+    // have drained rather than from the producer that lost them.
+    if (removesLostPending)
+    {
+        removesLostPending = false;
+        for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+        {
+            if (laneStats[lane].removesLost)
+            {
+                BEEPR_LOGW("%s lane: %lu removes lost with the park ring full, entries expire instead\n",
+                           laneConfigs[lane].name, (unsigned long)laneStats[lane].removesLost);
+            }
+        }
+    }
+    if (statsPendingAfterDrain)
+    {
+        statsPendingAfterDrain = false;
+        printStats();
+    }
+    return false;
+}
+
+uint32_t BeeprEvents::pendingCount()
+{
+    uint32_t pending = 0;
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        if (laneQueues[lane])
+        {
+            pending += uxQueueMessagesWaiting(laneQueues[lane]);
+        }
+        pending += backlogCount((EventLane)lane) + parkedCount((EventLane)lane);
+    }
+    return pending;
+}
+
+uint32_t BeeprEvents::msSinceLastEnqueue()
+{
+    return millis() - lastEnqueueMs;
+}
+
+uint8_t BeeprEvents::laneDepth(EventLane lane)
+{
+    return lane < EventLaneCount ? laneConfigs[lane].depth : 0;
+}
+
+uint32_t BeeprEvents::laneHighWater(EventLane lane)
+{
+    return lane < EventLaneCount ? laneStats[lane].highWater : 0;
+}
+
+bool BeeprEvents::laneCounters(EventLane lane, EventLaneStats &out)
+{
+    if (lane >= EventLaneCount)
+    {
+        return false;
+    }
+    out = laneStats[lane];
+    return true;
+}
+
+void BeeprEvents::injectStorm(uint16_t count)
+{
+    // Mostly low-priority traffic with calls, alarms and mail sprinkled in,
+    // to verify the urgent lanes stay fast while the bulk lane saturates.
+    static const NotificationCategory bulkCategories[] = {
+        CategoryIDSocial, CategoryIDNews, CategoryIDEntertainment};
+
+    BEEPR_LOGI("Injecting storm of %u events\n", (unsigned)count);
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        PendingNotifEvent event = {};
+        event.type = PendingEventAdd;
+        event.uid = 0xF0000000UL | i;
+        event.record = BeeprNotifs::claimRecord();
+        NotifRecord *rec = BeeprNotifs::record(event.record);
+        if (!rec)
+        {
+            continue;
+        }
+        if (i % 10 == 9)
+        {
+            event.category = CategoryIDIncomingCall;
+        }
+        else if (i % 7 == 6)
+        {
+            event.category = CategoryIDSchedule;
+        }
+        else if (i % 5 == 4)
+        {
+            event.category = CategoryIDEmail;
+        }
+        else
+        {
+            event.category = bulkCategories[i % 3];
+        }
+        snprintf(rec->app, sizeof(rec->app), "Storm");
+        snprintf(rec->title, sizeof(rec->title), "Storm %u", (unsigned)i);
+        snprintf(rec->message, sizeof(rec->message), "Lane %u", (unsigned)laneFor(event.category));
+        enqueue(event);
+    }
+    statsPendingAfterDrain = true;
+}
+
+void BeeprEvents::printStats()
+{
+    Serial.println("Event lanes:");
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        const EventLaneStats &stats = laneStats[lane];
+        uint32_t avgUs = stats.dequeued ? (uint32_t)(stats.latencyTotalUs / stats.dequeued) : 0;
+        Serial.printf("  %-6s depth=%u hw=%lu in=%lu out=%lu drop=%lu lat avg=%luus max=%luus\n",
+                      laneConfigs[lane].name, (unsigned)laneConfigs[lane].depth,
+                      (unsigned long)stats.highWater, (unsigned long)stats.enqueued,
+                      (unsigned long)stats.dequeued, (unsigned long)stats.dropped,
+                      (unsigned long)avgUs, (unsigned long)stats.latencyMaxUs);
+        if (stats.removesParked)
+        {
+            Serial.printf("         removes parked=%lu (now %u/%u) lost=%lu\n", (unsigned long)stats.removesParked,
+                          (unsigned)parkedCount((EventLane)lane), (unsigned)parked[lane].capacity,
+                          (unsigned long)stats.removesLost);
+        }
+        if (backlogs[lane].capacity > 0)
+        {
+            Serial.printf("         backlog %u/%u hw=%lu spilled=%lu\n", (unsigned)backlogCount((EventLane)lane),
+                          (unsigned)backlogs[lane].capacity, (unsigned long)stats.backlogHighWater,
+                          (unsigned long)stats.spilled);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef BEEPR_EVENTS_H
+#define BEEPR_EVENTS_H
+
+#include <Arduino.h>
+#include "esp32notifications.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+enum PendingEventType : uint8_t
+{
+    PendingEventAdd = 0,
+    PendingEventRemove = 1
+};
+
+struct PendingNotifEvent
+{
+    PendingEventType type;
+    uint32_t uid;
+    NotificationCategory category;
+    uint8_t categoryCount;
+    uint32_t time;
+    uint32_t enqueuedUs;
+    uint16_t record; // NotifRecord pool index for adds, NOTIF_NO_RECORD otherwise.
+    uint32_t laneMark; // Events that had entered its lane before it; set by enqueue().
+};
+
+// Priority lanes, highest priority first. Each lane is its own queue, so a
+// burst in a low lane can never evict an event from a higher one.
+enum EventLane : uint8_t
+{
+    EventLaneUrgent = 0, // Incoming/missed calls, voicemail
+    EventLaneHigh = 1,   // Schedule, email
+    EventLaneBulk = 2,   // Social, news, entertainment, everything else
+    EventLaneCount = 3
+};
+
+// Producer-side counters are updated atomically (several producers); the
+// dequeue and latency counters only by the consumer task.
+struct EventLaneStats
+{
+    uint32_t enqueued;
+    uint32_t dropped;
+    uint32_t dequeued;
+    uint32_t highWater;
+    uint32_t latencyMaxUs;
+    uint64_t latencyTotalUs;
+    uint32_t spilled;          // Went to the PSRAM backlog.
+    uint32_t backlogHighWater;
+    uint32_t removesParked;    // Removes that found the lane full or were evicted.
+    uint32_t removesLost;      // Removes that found the park ring full too.
+};
+
+namespace BeeprEvents
+{
+    void begin();
+    // Task notified whenever an event is queued.
+    void attachConsumer(TaskHandle_t task);
+    EventLane laneFor(NotificationCategory category);
+    // Takes ownership of event.record; it is released if the event is dropped.
+    bool enqueue(PendingNotifEvent &event);
+    bool dequeue(PendingNotifEvent &event);
+    uint32_t pendingCount();
+    uint32_t msSinceLastEnqueue();
+    uint8_t laneDepth(EventLane lane);
+    uint32_t laneHighWater(EventLane lane);
+    bool laneCounters(EventLane lane, EventLaneStats &out);
+    void injectStorm(uint16_t count);
+    void printStats();
+}
+
+#endif
@@ -0,0 +1,532 @@
+#include "beepr_filter.h"
+#include "beepr_config.h"
+#include "beepr_log.h"
+#include "knownApps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <Preferences.h>
+#include <algorithm>
+
+enum FilterRuleKind : uint8_t
+{
+    RuleApp = 0,
+    RuleCategory = 1,
+    RuleCategoryTitle = 2
+};
+
+struct FilterRule
+{
+    FilterRuleKind kind;
+    bool allow;
+    uint8_t category;
+    int16_t appIndex;
+    uint32_t bundleHash;
+    union
+    {
+        char titleNeedle[FILTER_TITLE_NEEDLE_LEN]; // Category+title rules.
+        char bundleId[FILTER_BUNDLE_ID_LEN];       // App rules, normalized.
+    };
+    uint32_t hits;
+};
+
+struct AppHashEntry
+{
+    uint32_t hash;
+    uint16_t index;
+};
+
+struct UnknownAppSlot
+{
+    uint32_t hash;
+    int8_t rule;
+};
+
+static const uint8_t CATEGORY_COUNT = 12;
+static const uint8_t UNKNOWN_APP_SLOTS = 32; // Power of two, > FILTER_MAX_RULES.
+static const char *kCategoryNames[CATEGORY_COUNT] = {
+    "other", "call", "missed", "voicemail", "social", "schedule",
+    "email", "news", "health", "finance", "location", "entertainment"};
+
+// A rule set and its compiled lookup tables. evaluate() runs in the BLE task
+// without a lock, so a reload never touches the published table: it builds
+// the spare one and swaps the pointer. A reader pins the table it looked up
+// until it is done, and the next reload waits for the spare to be unpinned.
+struct FilterTable
+{
+    FilterRule rules[FILTER_MAX_RULES];
+    uint8_t ruleCount;
+    uint32_t appRuleBits[(kAppNameCount + 31) / 32];
+    UnknownAppSlot unknownAppSlots[UNKNOWN_APP_SLOTS];
+    int8_t categoryRule[CATEGORY_COUNT];
+    uint16_t categoryTitleMask;
+    uint8_t readers;
+};
+
+static AppHashEntry appHashes[kAppNameCount];
+static bool appHashesReady = false;
+
+// Rules are only loaded from setup() and the console, one load at a time.
+static FilterTable tables[2];
+static FilterTable *publishedTable = &tables[0];
+static portMUX_TYPE tableMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t evaluatedCount = 0;
+static uint32_t rejectedCount = 0;
+static uint32_t rejectMaxCycles = 0;
+
+// FNV-1a over the bundle id, normalized like findAppIndex() (trimmed,
+// unquoted, case-insensitive).
+static uint32_t hashBundleId(const char *s, size_t len)
+{
+    trimBundleId(s, len);
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= (uint8_t)tolower((unsigned char)s[i]);
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static void buildAppHashes()
+{
+    for (size_t i = 0; i < kAppNameCount; ++i)
+    {
+        appHashes[i].hash = hashBundleId(kAppNames[i].bundleId, strlen(kAppNames[i].bundleId));
+        appHashes[i].index = (uint16_t)i;
+    }
+    std::sort(appHashes, appHashes + kAppNameCount,
+              [](const AppHashEntry &a, const AppHashEntry &b) { return a.hash < b.hash; });
+    appHashesReady = true;
+}
+
+static bool bundleIdEquals(const char *s, size_t len, const char *bundleId)
+{
+    return strlen(bundleId) == len && strncasecmp(s, bundleId, len) == 0;
+}
+
+// The hash only narrows the search: a candidate must also match the
+// normalized id, so a colliding unknown id is not taken for a known app.
+static int16_t findAppIndexByHash(uint32_t hash, const char *s, size_t len)
+{
+    trimBundleId(s, len);
+    const AppHashEntry *begin = appHashes;
+    const AppHashEntry *end = appHashes + kAppNameCount;
+    const AppHashEntry *it = std::lower_bound(begin, end, hash,
+                                              [](const AppHashEntry &e, uint32_t h) { return e.hash < h; });
+    for (; it != end && it->hash == hash; ++it)
+    {
+        if (bundleIdEquals(s, len, kAppNames[it->index].bundleId))
+        {
+            return (int16_t)it->index;
+        }
+    }
+    return -1;
+}
+
+static int findCategory(const char *s, size_t len)
+{
+    if (len == 0)
+    {
+        return -1;
+    }
+    if (isdigit((unsigned char)s[0]))
+    {
+        int value = atoi(s);
+        return value < CATEGORY_COUNT ? value : -1;
+    }
+    for (uint8_t i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        if (strlen(kCategoryNames[i]) == len && strncasecmp(kCategoryNames[i], s, len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool containsIgnoreCase(const char *haystack, const char *needle)
+{
+    if (!needle[0])
+    {
+        return true;
+    }
+    for (; *haystack; ++haystack)
+    {
+        const char *h = haystack;
+        const char *n = needle;
+        while (*h && *n && tolower((unsigned char)*h) == tolower((unsigned char)*n))
+        {
+            h++;
+            n++;
+        }
+        if (!*n)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseRule(const char *line, size_t len, FilterRule &rule)
+{
+    if (len < 6 || (line[0] != '+' && line[0] != '-') || line[4] != ':')
+    {
+        return false;
+    }
+
+    memset(&rule, 0, sizeof(rule));
+    rule.allow = line[0] == '+';
+    rule.appIndex = -1;
+    const char *arg = line + 5;
+    size_t argLen = len - 5;
+
+    if (strncmp(line + 1, "app", 3) == 0)
+    {
+        rule.kind = RuleApp;
+        rule.bundleHash = hashBundleId(arg, argLen);
+        rule.appIndex = findAppIndexByHash(rule.bundleHash, arg, argLen);
+        trimBundleId(arg, argLen);
+        if (argLen == 0 || argLen >= sizeof(rule.bundleId))
+        {
+            return false;
+        }
+        memcpy(rule.bundleId, arg, argLen);
+        return true;
+    }
+    if (strncmp(line + 1, "cat", 3) != 0)
+    {
+        return false;
+    }
+
+    const char *sep = (const char *)memchr(arg, ':', argLen);
+    size_t catLen = sep ? (size_t)(sep - arg) : argLen;
+    int category = findCategory(arg, catLen);
+    if (category < 0)
+    {
+        return false;
+    }
+    rule.category = (uint8_t)category;
+    rule.kind = RuleCategory;
+    if (sep)
+    {
+        size_t needleLen = argLen - catLen - 1;
+        if (needleLen == 0 || needleLen >= sizeof(rule.titleNeedle))
+        {
+            return false;
+        }
+        memcpy(rule.titleNeedle, sep + 1, needleLen);
+        rule.kind = RuleCategoryTitle;
+    }
+    return true;
+}
+
+static void compileRules(FilterTable &table)
+{
+    memset(table.appRuleBits, 0, sizeof(table.appRuleBits));
+    memset(table.unknownAppSlots, 0, sizeof(table.unknownAppSlots));
+    for (uint8_t i = 0; i < UNKNOWN_APP_SLOTS; ++i)
+    {
+        table.unknownAppSlots[i].rule = -1;
+    }
+    for (uint8_t i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        table.categoryRule[i] = -1;
+    }
+    table.categoryTitleMask = 0;
+
+    // First rule wins when several target the same key. Unknown ids that
+    // share a hash get a slot each; lookups compare the id itself.
+    for (uint8_t r = 0; r < table.ruleCount; ++r)
+    {
+        const FilterRule &rule = table.rules[r];
+        if (rule.kind == RuleApp && rule.appIndex >= 0)
+        {
+            table.appRuleBits[rule.appIndex / 32] |= 1UL << (rule.appIndex % 32);
+        }
+        else if (rule.kind == RuleApp)
+        {
+            uint8_t slot = rule.bundleHash & (UNKNOWN_APP_SLOTS - 1);
+            bool duplicate = false;
+            while (table.unknownAppSlots[slot].rule >= 0)
+            {
+                const FilterRule &other = table.rules[table.unknownAppSlots[slot].rule];
+                if (table.unknownAppSlots[slot].hash == rule.bundleHash &&
+                    bundleIdEquals(rule.bundleId, strlen(rule.bundleId), other.bundleId))
+                {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & (UNKNOWN_APP_SLOTS - 1);
+            }
+            if (!duplicate)
+            {
+                table.unknownAppSlots[slot].hash = rule.bundleHash;
+                table.unknownAppSlots[slot].rule = (int8_t)r;
+            }
+        }
+        else if (rule.kind == RuleCategoryTitle)
+        {
+            table.categoryTitleMask |= 1U << rule.category;
+        }
+        else if (table.categoryRule[rule.category] < 0)
+        {
+            table.categoryRule[rule.category] = (int8_t)r;
+        }
+    }
+}
+
+static int findUnknownAppRule(const FilterTable &table, uint32_t hash, const char *s, size_t len)
+{
+    trimBundleId(s, len);
+    uint8_t slot = hash & (UNKNOWN_APP_SLOTS - 1);
+    for (uint8_t probes = 0; probes < UNKNOWN_APP_SLOTS; ++probes)
+    {
+        const UnknownAppSlot &entry = table.unknownAppSlots[slot];
+        if (entry.rule < 0)
+        {
+            return -1;
+        }
+        if (entry.hash == hash && bundleIdEquals(s, len, table.rules[entry.rule].bundleId))
+        {
+            return entry.rule;
+        }
+        slot = (slot + 1) & (UNKNOWN_APP_SLOTS - 1);
+    }
+    return -1;
+}
+
+static int findKnownAppRule(const FilterTable &table, int16_t appIndex)
+{
+    if (!(table.appRuleBits[appIndex / 32] & (1UL << (appIndex % 32))))
+    {
+        return -1;
+    }
+    for (uint8_t r = 0; r < table.ruleCount; ++r)
+    {
+        if (table.rules[r].kind == RuleApp && table.rules[r].appIndex == appIndex)
+        {
+            return r;
+        }
+    }
+    return -1;
+}
+
+static int matchRule(const FilterTable &table, uint32_t bundleHash, const String &bundleId, int16_t appIndex,
+                     uint8_t category, const String &title)
+{
+    int r = appIndex >= 0 ? findKnownAppRule(table, appIndex)
+                          : findUnknownAppRule(table, bundleHash, bundleId.c_str(), bundleId.length());
+    if (r >= 0 || category >= CATEGORY_COUNT)
+    {
+        return r;
+    }
+
+    if (table.categoryTitleMask & (1U << category))
+    {
+        for (uint8_t i = 0; i < table.ruleCount; ++i)
+        {
+            const FilterRule &rule = table.rules[i];
+            if (rule.kind == RuleCategoryTitle && rule.category == category &&
+                containsIgnoreCase(title.c_str(), rule.titleNeedle))
+            {
+                return i;
+            }
+        }
+    }
+    return table.categoryRule[category];
+}
+
+static FilterTable *pinTable()
+{
+    portENTER_CRITICAL(&tableMux);
+    FilterTable *table = publishedTable;
+    table->readers++;
+    portEXIT_CRITICAL(&tableMux);
+    return table;
+}
+
+static void unpinTable(FilterTable *table)
+{
+    portENTER_CRITICAL(&tableMux);
+    table->readers--;
+    portEXIT_CRITICAL(&tableMux);
+}
+
+// The table not published, once the last reader of it has let go. A reader
+// pins only the published table, so none can arrive while we wait.
+static FilterTable *spareTable()
+{
+    FilterTable *spare = publishedTable == &tables[0] ? &tables[1] : &tables[0];
+    for (;;)
+    {
+        portENTER_CRITICAL(&tableMux);
+        bool idle = spare->readers == 0;
+        portEXIT_CRITICAL(&tableMux);
+        if (idle)
+        {
+            return spare;
+        }
+        vTaskDelay(1);
+    }
+}
+
+static void publishTable(FilterTable *table)
+{
+    portENTER_CRITICAL(&tableMux);
+    publishedTable = table;
+    portEXIT_CRITICAL(&tableMux);
+}
+
+void BeeprFilter::begin()
+{
+    if (!appHashesReady)
+    {
+        buildAppHashes();
+    }
+
+    Preferences prefs;
+    String stored;
+    if (prefs.begin(FILTER_NVS_NAMESPACE, true))
+    {
+        stored = prefs.getString(FILTER_NVS_KEY, "");
+        prefs.end();
+    }
+    loadRules(stored.c_str());
+}
+
+bool BeeprFilter::loadRules(const char *rulesText)
+{
+    if (!appHashesReady)
+    {
+        buildAppHashes();
+    }
+
+    FilterTable *table = spareTable();
+    table->ruleCount = 0;
+    bool ok = true;
+    const char *line = rulesText ? rulesText : "";
+    while (*line)
+    {
+        size_t len = strcspn(line, ";\n");
+        const char *next = line[len] ? line + len + 1 : line + len;
+        while (len && isBundleIdTrimChar(*line))
+        {
+            line++;
+            len--;
+        }
+        while (len && isBundleIdTrimChar(line[len - 1]))
+        {
+            len--;
+        }
+
+        if (len > 0)
+        {
+            if (table->ruleCount >= FILTER_MAX_RULES)
+            {
+                BEEPR_LOGW("Filter: too many rules, max %u\n", (unsigned)FILTER_MAX_RULES);
+                ok = false;
+                break;
+            }
+            if (parseRule(line, len, table->rules[table->ruleCount]))
+            {
+                table->ruleCount++;
+            }
+            else
+            {
+                BEEPR_LOGW("Filter: bad rule '%.*s'\n", (int)len, line);
+                ok = false;
+            }
+        }
+        line = next;
+    }
+
+    // All or nothing: a rejected set must not run while NVS keeps the old one.
+    if (!ok)
+    {
+        BEEPR_LOGW("Filter: rules rejected, keeping the current set\n");
+        return false;
+    }
+    compileRules(*table);
+    publishTable(table);
+    BEEPR_LOGI("Filter: %u rule(s) loaded\n", (unsigned)table->ruleCount);
+    return true;
+}
+
+bool BeeprFilter::saveRules(const char *rulesText)
+{
+    if (!loadRules(rulesText))
+    {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(FILTER_NVS_NAMESPACE, false))
+    {
+        BEEPR_LOGE("Filter: failed to open NVS\n");
+        return false;
+    }
+    prefs.putString(FILTER_NVS_KEY, rulesText ? rulesText : "");
+    prefs.end();
+    return true;
+}
+
+FilterVerdict BeeprFilter::evaluate(const String &bundleId, NotificationCategory category, const String &title)
+{
+    uint32_t startCycles = ESP.getCycleCount();
+
+    FilterVerdict verdict = {true, -1};
+    uint32_t bundleHash = hashBundleId(bundleId.c_str(), bundleId.length());
+    verdict.appIndex = findAppIndexByHash(bundleHash, bundleId.c_str(), bundleId.length());
+    evaluatedCount++;
+
+    FilterTable *table = pinTable();
+    int r = table->ruleCount ? matchRule(*table, bundleHash, bundleId, verdict.appIndex, (uint8_t)category, title) : -1;
+    if (r >= 0)
+    {
+        __atomic_fetch_add(&table->rules[r].hits, 1, __ATOMIC_RELAXED);
+        verdict.allow = table->rules[r].allow;
+    }
+    unpinTable(table);
+
+    if (!verdict.allow)
+    {
+        rejectedCount++;
+        uint32_t cycles = ESP.getCycleCount() - startCycles;
+        if (cycles > rejectMaxCycles)
+        {
+            rejectMaxCycles = cycles;
+        }
+    }
+    return verdict;
+}
+
+void BeeprFilter::printStats()
+{
+    Serial.printf("Filter: evaluated=%lu rejected=%lu reject max=%lu cycles (%lu ns)\n",
+                  (unsigned long)evaluatedCount, (unsigned long)rejectedCount,
+                  (unsigned long)rejectMaxCycles,
+                  (unsigned long)(rejectMaxCycles * 1000UL / ESP.getCpuFreqMHz()));
+    FilterTable *table = pinTable();
+    for (uint8_t r = 0; r < table->ruleCount; ++r)
+    {
+        const FilterRule &rule = table->rules[r];
+        const char *kind = rule.kind == RuleApp ? "app" : (rule.kind == RuleCategory ? "cat" : "cat+title");
+        Serial.printf("  #%u %c%s", (unsigned)r, rule.allow ? '+' : '-', kind);
+        if (rule.kind == RuleApp)
+        {
+            Serial.printf(" %s%s", rule.bundleId, rule.appIndex >= 0 ? "" : " (unknown id)");
+        }
+        else
+        {
+            Serial.printf(" %s", kCategoryNames[rule.category]);
+        }
+        if (rule.kind == RuleCategoryTitle)
+        {
+            Serial.printf(" \"%s\"", rule.titleNeedle);
+        }
+        Serial.printf(" hits=%lu\n", (unsigned long)__atomic_load_n(&rule.hits, __ATOMIC_RELAXED));
+    }
+    unpinTable(table);
+}
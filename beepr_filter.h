@@ -0,0 +1,31 @@
+#ifndef BEEPR_FILTER_H
+#define BEEPR_FILTER_H
+
+#include <Arduino.h>
+#include "esp32notifications.h"
+
+// Rules are stored as text, one per line (or separated by ';'):
+//   -app:com.cardify.tinder   deny a bundle id
+//   +app:com.apple.MobileSMS  allow a bundle id
+//   -cat:news                 deny a category (name or ANCS number)
+//   -cat:social:promo         deny a category when the title contains "promo"
+// Precedence: app rules, then category+title rules, then category rules.
+// Anything unmatched is allowed.
+struct FilterVerdict
+{
+    bool allow;
+    int16_t appIndex; // Index into kAppNames, -1 when not an exact known id.
+};
+
+namespace BeeprFilter
+{
+    void begin();
+    // Replaces the live rules only if every line parses; false leaves them as
+    // they were. saveRules() also writes the text to NVS, on success only.
+    bool loadRules(const char *rulesText);
+    bool saveRules(const char *rulesText);
+    FilterVerdict evaluate(const String &bundleId, NotificationCategory category, const String &title);
+    void printStats();
+}
+
+#endif
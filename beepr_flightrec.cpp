@@ -0,0 +1,170 @@
+#include "beepr_flightrec.h"
+#include "beepr_config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+
+static_assert((FLIGHTREC_RECORDS & (FLIGHTREC_RECORDS - 1)) == 0, "FLIGHTREC_RECORDS must be a power of two");
+
+// Bumped whenever the record layout changes; folded into the magic so a
+// firmware with a different layout or ring size starts afresh.
+static const uint8_t FLIGHTREC_VERSION = 1;
+static const uint32_t FLIGHTREC_MAGIC = 0x46524543UL ^ (FLIGHTREC_VERSION << 24) ^ FLIGHTREC_RECORDS;
+static const uint8_t RECORDS_PER_LINE = 4;
+
+// Word-sized fields only: RTC slow memory is written with plain 32-bit stores.
+struct FlightRecord
+{
+    uint32_t tick;
+    uint32_t packed; // event | arg8 << 8 | arg16 << 16
+};
+
+struct FlightRecHeader
+{
+    uint32_t magic;
+    uint32_t head;
+    uint32_t bootCount;
+};
+
+static RTC_NOINIT_ATTR FlightRecHeader rtcHeader;
+static RTC_NOINIT_ATTR FlightRecord rtcRing[FLIGHTREC_RECORDS];
+
+// Claimed with an atomic add in DRAM (RTC memory has no atomics). published
+// is one past the newest written record and only moves forward; it is
+// mirrored to rtcHeader.head after every record.
+static uint32_t head = 0;
+static uint32_t published = 0;
+static bool recording = false;
+static uint32_t lastHeapLowKb = 0;
+
+static const char *resetReasonName(esp_reset_reason_t reason)
+{
+    switch (reason)
+    {
+    case ESP_RST_POWERON:
+        return "power-on";
+    case ESP_RST_EXT:
+        return "external";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+        return "interrupt watchdog";
+    case ESP_RST_TASK_WDT:
+        return "task watchdog";
+    case ESP_RST_WDT:
+        return "other watchdog";
+    case ESP_RST_DEEPSLEEP:
+        return "deep sleep";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    case ESP_RST_SDIO:
+        return "SDIO";
+    default:
+        return "unknown";
+    }
+}
+
+static void dumpRing(esp_reset_reason_t reason)
+{
+    Serial.printf("FR BEGIN v%u boot=%lu reason=%u records=%lu tick_ms=%lu\n", (unsigned)FLIGHTREC_VERSION,
+                  (unsigned long)rtcHeader.bootCount, (unsigned)reason, (unsigned long)FLIGHTREC_RECORDS,
+                  (unsigned long)portTICK_PERIOD_MS);
+    // Oldest first, so the decoder needs no head pointer.
+    uint32_t start = rtcHeader.head;
+    for (uint32_t i = 0; i < FLIGHTREC_RECORDS; i += RECORDS_PER_LINE)
+    {
+        char line[RECORDS_PER_LINE * 16 + 1];
+        char *p = line;
+        for (uint32_t j = 0; j < RECORDS_PER_LINE; j++)
+        {
+            const FlightRecord &r = rtcRing[(start + i + j) & (FLIGHTREC_RECORDS - 1)];
+            uint32_t words[2] = {r.tick, r.packed};
+            for (uint8_t w = 0; w < 2; w++)
+            {
+                for (uint8_t b = 0; b < 4; b++)
+                {
+                    p += sprintf(p, "%02x", (unsigned)((words[w] >> (8 * b)) & 0xFF));
+                }
+            }
+        }
+        Serial.printf("FR %04lx %s\n", (unsigned long)i, line);
+    }
+    Serial.println("FR END");
+}
+
+void BeeprFlightRec::begin()
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool valid = rtcHeader.magic == FLIGHTREC_MAGIC && reason != ESP_RST_POWERON;
+    if (valid)
+    {
+        Serial.printf("Flight recorder: reset reason %s after boot %lu, previous events follow\n",
+                      resetReasonName(reason), (unsigned long)rtcHeader.bootCount);
+        dumpRing(reason);
+    }
+    else
+    {
+        memset(rtcRing, 0, sizeof(rtcRing));
+        rtcHeader.head = 0;
+        rtcHeader.bootCount = 0;
+        rtcHeader.magic = FLIGHTREC_MAGIC;
+    }
+
+    rtcHeader.bootCount++;
+    head = rtcHeader.head;
+    published = head;
+    recording = true;
+    record(FlightBoot, (uint8_t)reason, (uint16_t)rtcHeader.bootCount);
+}
+
+void BeeprFlightRec::record(FlightEvent event, uint8_t arg8, uint16_t arg16)
+{
+    if (!recording)
+    {
+        return;
+    }
+    uint32_t slot = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    FlightRecord &r = rtcRing[slot & (FLIGHTREC_RECORDS - 1)];
+    r.tick = xTaskGetTickCount();
+    r.packed = (uint32_t)event | ((uint32_t)arg8 << 8) | ((uint32_t)arg16 << 16);
+
+    // Records can finish out of claim order (a task preempted between claim
+    // and store), so take the maximum rather than our own slot.
+    uint32_t next = slot + 1;
+    uint32_t seen = __atomic_load_n(&published, __ATOMIC_RELAXED);
+    while ((int32_t)(next - seen) > 0 &&
+           !__atomic_compare_exchange_n(&published, &seen, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    // A writer preempted between its load and store could still leave an
+    // older value behind, so store until the mirror matches what we read.
+    for (;;)
+    {
+        uint32_t value = __atomic_load_n(&published, __ATOMIC_RELAXED);
+        rtcHeader.head = value;
+        if (__atomic_load_n(&published, __ATOMIC_RELAXED) == value)
+        {
+            break;
+        }
+    }
+}
+
+void BeeprFlightRec::update()
+{
+    uint32_t minFreeKb = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT) / 1024;
+    if (lastHeapLowKb == 0 || minFreeKb < lastHeapLowKb)
+    {
+        lastHeapLowKb = minFreeKb;
+        record(FlightHeapLow, 0, (uint16_t)(minFreeKb > 0xFFFF ? 0xFFFF : minFreeKb));
+    }
+}
+
+void BeeprFlightRec::dump()
+{
+    dumpRing(esp_reset_reason());
+}
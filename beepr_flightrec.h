@@ -0,0 +1,38 @@
+#ifndef BEEPR_FLIGHTREC_H
+#define BEEPR_FLIGHTREC_H
+
+#include <Arduino.h>
+
+// Flight recorder: a ring of recent hot-path events in RTC slow memory that
+// survives soft resets (panic, watchdogs, brownout, esp_restart). It is
+// dumped at boot with the reset reason and decoded on a host with
+// tools/flightrec_decode.py. Recording is a few word stores, an atomic
+// increment and a compare-and-swap, so it stays on in every build.
+enum FlightEvent : uint8_t
+{
+    FlightNone = 0,
+    FlightBoot = 1,         // arg8 reset reason, arg16 boot count
+    FlightEnqueue = 2,      // arg8 lane, arg16 queue depth
+    FlightDrop = 3,         // arg8 lane, arg16 lane drop count
+    FlightStoreAdd = 4,     // arg16 store size
+    FlightStoreRemove = 5,  // arg8 1 if expired; arg16 store size
+    FlightRender = 6,       // arg8 0 status, 1 notification; arg16 compose us
+    FlightHeapLow = 7,      // arg16 minimum free heap (KB)
+    FlightConnected = 8,
+    FlightDisconnected = 9,
+    FlightEncrypted = 10,   // arg8 1 on success
+    FlightFirstNotif = 11   // arg16 ms since connect
+};
+
+namespace BeeprFlightRec
+{
+    // Dumps what the previous boots left and starts recording. Call first.
+    void begin();
+    void record(FlightEvent event, uint8_t arg8 = 0, uint16_t arg16 = 0);
+    // Records new heap low-water marks; cheap enough for loop().
+    void update();
+    // Dumps the ring as it is now, in the boot dump format.
+    void dump();
+}
+
+#endif
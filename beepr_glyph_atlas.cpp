@@ -0,0 +1,100 @@
+#include "beepr_glyph_atlas.h"
+
+static bool inAtlas(char c)
+{
+    uint8_t index = (uint8_t)c - GLYPH_ATLAS_FIRST;
+    return index < GLYPH_ATLAS_COUNT;
+}
+
+void BeeprGlyphAtlas::capture(GlyphAtlas &atlas, char c, const uint8_t *frame, int16_t frameWidth, int16_t x)
+{
+    if (!inAtlas(c) || x < 0 || x + GLYPH_ATLAS_WIDTH > frameWidth)
+    {
+        return;
+    }
+    uint16_t *columns = atlas.columns[(uint8_t)c - GLYPH_ATLAS_FIRST];
+    for (int16_t i = 0; i < GLYPH_ATLAS_WIDTH; i++)
+    {
+        columns[i] = (uint16_t)(frame[x + i] | (frame[frameWidth + x + i] << 8));
+    }
+}
+
+void BeeprGlyphAtlas::drawText(const GlyphAtlas &atlas, uint8_t *frame, int16_t frameWidth, int16_t framePages,
+                               int16_t x, int16_t baseline, const char *text)
+{
+    // Every glyph on the line lands on the same pages with the same shift,
+    // so the vertical placement is worked out once per call.
+    int16_t top = baseline - GLYPH_ATLAS_ASCENT;
+    uint8_t dropRows = 0;
+    if (top < 0)
+    {
+        if (top <= -16)
+        {
+            return;
+        }
+        dropRows = (uint8_t)-top;
+        top = 0;
+    }
+    int16_t page = top >> 3;
+    if (page >= framePages)
+    {
+        return;
+    }
+    uint8_t shift = top & 7;
+    uint8_t *row0 = frame + page * frameWidth;
+    uint8_t *row1 = page + 1 < framePages ? row0 + frameWidth : nullptr;
+    uint8_t *row2 = page + 2 < framePages ? row0 + 2 * frameWidth : nullptr;
+
+    for (; *text && x < frameWidth; text++)
+    {
+        if (!inAtlas(*text))
+        {
+            continue;
+        }
+        const uint16_t *columns = atlas.columns[(uint8_t)*text - GLYPH_ATLAS_FIRST];
+        for (int16_t i = 0; i < GLYPH_ATLAS_WIDTH; i++)
+        {
+            int16_t col = x + i;
+            if (col < 0 || col >= frameWidth)
+            {
+                continue;
+            }
+            uint32_t bits = (uint32_t)(columns[i] >> dropRows) << shift;
+            row0[col] |= (uint8_t)bits;
+            if (row1)
+            {
+                row1[col] |= (uint8_t)(bits >> 8);
+            }
+            if (row2)
+            {
+                row2[col] |= (uint8_t)(bits >> 16);
+            }
+        }
+        x += GLYPH_ATLAS_WIDTH;
+    }
+}
+
+int16_t BeeprGlyphAtlas::textWidth(const GlyphAtlas &atlas, const char *text)
+{
+    int16_t width = 0;
+    int16_t lastInk = 0;
+    for (; *text; text++)
+    {
+        if (!inAtlas(*text))
+        {
+            continue;
+        }
+        const uint16_t *columns = atlas.columns[(uint8_t)*text - GLYPH_ATLAS_FIRST];
+        lastInk = 0;
+        for (int16_t i = GLYPH_ATLAS_WIDTH; i > 0; i--)
+        {
+            if (columns[i - 1])
+            {
+                lastInk = i;
+                break;
+            }
+        }
+        width += GLYPH_ATLAS_WIDTH;
+    }
+    return width > 0 ? width - GLYPH_ATLAS_WIDTH + lastInk : 0;
+}
@@ -0,0 +1,37 @@
+#ifndef BEEPR_GLYPH_ATLAS_H
+#define BEEPR_GLYPH_ATLAS_H
+
+#include <stdint.h>
+
+// Pre-decoded fixed-width font for page-organized framebuffers (the
+// u8g2/SH1106 layout: rows of 8-pixel pages, one byte per column, bit 0 at
+// the top). Each glyph is a set of 16-bit column masks, bit 0 being
+// GLYPH_ATLAS_ASCENT rows above the baseline, so drawing a character is a few
+// shifted ORs per column instead of a run through the compressed font
+// decoder. No Arduino dependencies, so it builds unchanged on a host.
+
+static const uint8_t GLYPH_ATLAS_FIRST = 0x20;
+static const uint8_t GLYPH_ATLAS_COUNT = 95; // Printable ASCII, as in the _tr fonts.
+static const int16_t GLYPH_ATLAS_WIDTH = 6;
+static const int16_t GLYPH_ATLAS_ASCENT = 12;
+
+struct GlyphAtlas
+{
+    uint16_t columns[GLYPH_ATLAS_COUNT][GLYPH_ATLAS_WIDTH];
+};
+
+namespace BeeprGlyphAtlas
+{
+    // Captures a glyph drawn at column x with its baseline on row
+    // GLYPH_ATLAS_ASCENT (pages 0-1) of a frame.
+    void capture(GlyphAtlas &atlas, char c, const uint8_t *frame, int16_t frameWidth, int16_t x);
+    // ORs text into the frame like u8g2's transparent drawStr(); characters
+    // outside the atlas are skipped without advancing.
+    void drawText(const GlyphAtlas &atlas, uint8_t *frame, int16_t frameWidth, int16_t framePages, int16_t x,
+                  int16_t baseline, const char *text);
+    // Advance of all but the last glyph plus the last one's inked columns,
+    // which is how u8g2 measures strings.
+    int16_t textWidth(const GlyphAtlas &atlas, const char *text);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#include "beepr_log.h"
+
+#include <stdarg.h>
+
+void beeprLogPrintf(const char *format, ...)
+{
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len <= 0)
+    {
+        return;
+    }
+    if ((size_t)len >= sizeof(line))
+    {
+        // Cut short: keep the line break so the next line starts clean.
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+    Serial.write((const uint8_t *)line, (size_t)len);
+}
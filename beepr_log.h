@@ -0,0 +1,29 @@
+#ifndef BEEPR_LOG_H
+#define BEEPR_LOG_H
+
+#include <Arduino.h>
+#include "beepr_config.h"
+
+// Formats one line on the caller's stack and writes it out, cut at
+// LOG_LINE_MAX. Unlike Print::printf it never allocates, which it does for
+// any line of 64 bytes or more, so logging is safe on the ingest path.
+void beeprLogPrintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Leveled serial logging. The level is a compile-time constant, so calls
+// below it fold away together with their format strings. Console command
+// output (printStats and friends) is not logging and always prints.
+#define BEEPR_LOG_AT(level, ...)              \
+    do                                        \
+    {                                         \
+        if (BEEPR_LOG_LEVEL >= (level))       \
+        {                                     \
+            beeprLogPrintf(__VA_ARGS__);      \
+        }                                     \
+    } while (0)
+
+#define BEEPR_LOGE(...) BEEPR_LOG_AT(BEEPR_LOG_ERROR, __VA_ARGS__)
+#define BEEPR_LOGW(...) BEEPR_LOG_AT(BEEPR_LOG_WARN, __VA_ARGS__)
+#define BEEPR_LOGI(...) BEEPR_LOG_AT(BEEPR_LOG_INFO, __VA_ARGS__)
+#define BEEPR_LOGD(...) BEEPR_LOG_AT(BEEPR_LOG_DEBUG, __VA_ARGS__)
+
+#endif
@@ -1,33 +1,176 @@
 #include "beepr_notifs.h"
+#include "beepr_alert.h"
 #include "beepr_display.h"
-#include <vector>
+#include "beepr_flightrec.h"
+#include "beepr_log.h"
+#include "beepr_power.h"
+#include "beepr_ttl_wheel.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
+#include "esp_heap_caps.h"
+
+static const uint8_t NO_SLOT = 0xFF;
+static const uint8_t GROUP_TABLE_SIZE = 64; // Power of two, > NOTIF_STORE_CAPACITY.
+
+// Store entries live in fixed slots threaded on three intrusive lists: store
+// order (oldest first), same app, and same category. Add/remove relink in
+// O(1) and never move other entries.
 struct StoredNotification
 {
-    String app;
-    String contact;
-    String message;
     uint32_t uid;
+    uint32_t appKey;
+    uint32_t contentHash; // app + title + message, to spot no-op re-sends.
+    uint32_t arrivedMs;   // Last new content; the age shown and the expiry start.
+    uint16_t record;
+    uint8_t category;
+    uint8_t group;
+    uint8_t prev;
+    uint8_t next;
+    uint8_t appPrev;
+    uint8_t appNext;
+    uint8_t catPrev;
+    uint8_t catNext;
+    uint8_t hotPrev;
+    uint8_t hotNext;
+};
+
+struct IndexList
+{
+    uint8_t head;
+    uint8_t tail;
+    uint8_t count;
+};
+
+struct AppGroup
+{
+    uint32_t key;
+    IndexList entries;
+    uint8_t prev; // Group order, by first arrival.
+    uint8_t next;
 };
 
-static std::vector<StoredNotification> notifList;
-static size_t currentIndex = 0;
+struct StoreStats
+{
+    uint32_t writerOps;
+    uint32_t writerWaitUsMax;
+    uint64_t writerWaitUsTotal;
+    uint32_t viewsPublished;
+    uint32_t readerAcquires;
+    uint32_t readerMaxCycles;
+    uint32_t duplicateUpdates;
+};
+
+// Text records come in two tiers allocated once by begin(). Without PSRAM
+// the whole pool is internal (fast tier only). With PSRAM, ingest, the event
+// lanes and their backlogs use PSRAM records, and the NOTIF_HOT_RECORDS
+// internal ones are a cache of store entries (one record kept spare): the
+// current and the newest entry are copied in whenever a view is published,
+// evicting the least recently used hot entry back to PSRAM. Refcounts and free lists are
+// metadata and always internal. Indices below fastRecordCount are fast.
+static const uint16_t RECORD_INDEX_MAX = NOTIF_RECORD_POOL_SIZE + EVENT_BACKLOG_HIGH + EVENT_BACKLOG_BULK;
+
+struct RecordTierStats
+{
+    uint32_t fastClaims;
+    uint32_t slowClaims;
+    uint32_t exhausted;
+    uint16_t inUseMax;
+    uint32_t promotions;
+    uint32_t demotions;
+    uint32_t promoteMisses; // No internal record free, even after an eviction.
+};
+
+static NotifRecord *fastRecords = nullptr;
+static NotifRecord *slowRecords = nullptr;
+static uint16_t fastRecordCount = 0;
+static uint16_t slowRecordCount = 0;
+static uint8_t recordRefs[RECORD_INDEX_MAX];
+static uint16_t freeFast[RECORD_INDEX_MAX];
+static uint16_t freeSlow[RECORD_INDEX_MAX];
+static uint16_t freeFastCount = 0;
+static uint16_t freeSlowCount = 0;
+static RecordTierStats tierStats = {};
+static portMUX_TYPE recordPoolMux = portMUX_INITIALIZER_UNLOCKED;
+
+static NotifView viewPool[NOTIF_VIEW_POOL_SIZE];
+static NotifView *publishedView = nullptr;
+static portMUX_TYPE viewMux = portMUX_INITIALIZER_UNLOCKED;
+
+static StoredNotification slots[NOTIF_STORE_CAPACITY];
+static uint8_t freeSlots[NOTIF_STORE_CAPACITY];
+static uint8_t freeSlotCount = 0;
+static IndexList storeOrder = {NO_SLOT, NO_SLOT, 0};
+// Slots holding an internal record while there is a PSRAM tier, least
+// recently used first.
+static IndexList hotOrder = {NO_SLOT, NO_SLOT, 0};
+static const uint16_t NOTIF_HOT_ENTRIES = NOTIF_HOT_RECORDS - 1;
+static_assert(NOTIF_HOT_RECORDS >= 3, "the hot cache needs two entries and a spare record");
+static uint8_t currentSlot = NO_SLOT;
+
+static AppGroup groups[NOTIF_STORE_CAPACITY];
+static uint8_t freeGroups[NOTIF_STORE_CAPACITY];
+static uint8_t freeGroupCount = 0;
+static IndexList groupOrder = {NO_SLOT, NO_SLOT, 0};
+static uint8_t groupTable[GROUP_TABLE_SIZE];
+
+static IndexList categoryLists[NOTIF_CATEGORY_COUNT];
+
 static SemaphoreHandle_t notifMutex = nullptr;
 static SemaphoreHandle_t displayMutex = nullptr;
 static portMUX_TYPE mutexInitMux = portMUX_INITIALIZER_UNLOCKED;
 
-struct DisplaySnapshot
-{
-    bool hasNotification;
-    String app;
-    String contact;
-    String message;
-    size_t current;
-    size_t total;
+static StoreStats storeStats = {};
+// While the contention bench runs (store empty when it started), its entries
+// neither alert nor wake the panel, and nothing is rendered until it is over.
+static const uint32_t BENCH_UID_BASE = 0xE0000000UL;
+static const uint8_t BENCH_UIDS = 8;
+static volatile bool benchRunning = false;
+static volatile bool benchWriterDone = false;
+
+static const uint32_t NO_DEADLINE = 0xFFFFFFFFUL;
+
+// ANCS category -> minutes until a stored entry expires (see beepr_config.h).
+static const uint16_t categoryTtlMin[NOTIF_CATEGORY_COUNT] = {
+    NOTIF_TTL_DEFAULT_MIN,  // Other
+    NOTIF_TTL_RINGING_MIN,  // Incoming call
+    NOTIF_TTL_MISSED_MIN,   // Missed call
+    NOTIF_TTL_MISSED_MIN,   // Voicemail
+    NOTIF_TTL_DEFAULT_MIN,  // Social
+    NOTIF_TTL_SCHEDULE_MIN, // Schedule
+    NOTIF_TTL_DEFAULT_MIN,  // Email
+    NOTIF_TTL_NEWS_MIN,     // News
+    NOTIF_TTL_DEFAULT_MIN,  // Health and fitness
+    NOTIF_TTL_DEFAULT_MIN,  // Business and finance
+    NOTIF_TTL_DEFAULT_MIN,  // Location
+    NOTIF_TTL_NEWS_MIN,     // Entertainment
 };
 
+// One expiry timer per store slot, guarded by the store mutex. The next
+// deadline is cached so update() only takes the mutex once it is due; a
+// stale value is never later than the real one (cancels only postpone it).
+static_assert(NOTIF_STORE_CAPACITY <= TTL_WHEEL_TIMERS, "store slots must fit the TTL wheel");
+static TtlWheel ttlWheel;
+static volatile bool expiryArmed = false;
+static volatile uint32_t expiryDueMs = 0;
+static uint32_t expiredTotal = 0;
+static uint32_t expiryBatches = 0;
+static TaskHandle_t timerTask = nullptr;
+
+// When the age on screen next changes, guarded by the display mutex.
+static volatile bool ageArmed = false;
+static volatile uint32_t ageDueMs = 0;
+
+static void statMax(uint32_t &counter, uint32_t value)
+{
+    uint32_t seen = __atomic_load_n(&counter, __ATOMIC_RELAXED);
+    while (value > seen &&
+           !__atomic_compare_exchange_n(&counter, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
 static SemaphoreHandle_t getNotifMutex()
 {
     if (notifMutex == nullptr)
@@ -36,6 +179,20 @@ static SemaphoreHandle_t getNotifMutex()
         if (notifMutex == nullptr)
         {
             notifMutex = xSemaphoreCreateMutex();
+            for (uint8_t i = 0; i < NOTIF_STORE_CAPACITY; ++i)
+            {
+                freeSlots[i] = NOTIF_STORE_CAPACITY - 1 - i;
+                freeGroups[i] = NOTIF_STORE_CAPACITY - 1 - i;
+                slots[i].record = NOTIF_NO_RECORD;
+            }
+            freeSlotCount = NOTIF_STORE_CAPACITY;
+            freeGroupCount = NOTIF_STORE_CAPACITY;
+            memset(groupTable, NO_SLOT, sizeof(groupTable));
+            BeeprTtlWheel::reset(ttlWheel, millis());
+            for (uint8_t c = 0; c < NOTIF_CATEGORY_COUNT; ++c)
+            {
+                categoryLists[c] = {NO_SLOT, NO_SLOT, 0};
+            }
         }
         portEXIT_CRITICAL(&mutexInitMux);
     }
@@ -56,254 +213,1233 @@ static SemaphoreHandle_t getDisplayMutex()
     return displayMutex;
 }
 
-static int findIndexByUidLocked(uint32_t uid)
+// Writers serialize on the store mutex; the wait is recorded so contention
+// with readers (which never take it) can be measured.
+static SemaphoreHandle_t lockStore()
+{
+    SemaphoreHandle_t m = getNotifMutex();
+    if (!m)
+    {
+        return nullptr;
+    }
+    uint32_t startUs = micros();
+    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+    {
+        return nullptr;
+    }
+    uint32_t waitUs = micros() - startUs;
+    storeStats.writerOps++;
+    storeStats.writerWaitUsTotal += waitUs;
+    if (waitUs > storeStats.writerWaitUsMax)
+    {
+        storeStats.writerWaitUsMax = waitUs;
+    }
+    return m;
+}
+
+static uint16_t recordCount()
+{
+    return fastRecordCount + slowRecordCount;
+}
+
+void BeeprNotifs::begin()
 {
-    for (size_t i = 0; i < notifList.size(); ++i)
+    if (fastRecords)
     {
-        if (notifList[i].uid == uid)
+        return;
+    }
+    if (psramFound())
+    {
+        slowRecordCount = NOTIF_RECORD_POOL_SIZE - NOTIF_HOT_RECORDS + EVENT_BACKLOG_HIGH + EVENT_BACKLOG_BULK;
+        slowRecords = (NotifRecord *)heap_caps_calloc(slowRecordCount, sizeof(NotifRecord), MALLOC_CAP_SPIRAM);
+    }
+    if (slowRecords)
+    {
+        fastRecordCount = NOTIF_HOT_RECORDS;
+    }
+    else
+    {
+        // No PSRAM: one internal pool, lane backlogs stay disabled.
+        slowRecordCount = 0;
+        fastRecordCount = NOTIF_RECORD_POOL_SIZE;
+    }
+    fastRecords = (NotifRecord *)heap_caps_calloc(fastRecordCount, sizeof(NotifRecord),
+                                                  MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!fastRecords)
+    {
+        BEEPR_LOGE("Record pool allocation failed\n");
+        fastRecordCount = 0;
+    }
+
+    portENTER_CRITICAL(&recordPoolMux);
+    for (uint16_t i = 0; i < fastRecordCount; ++i)
+    {
+        freeFast[i] = fastRecordCount - 1 - i;
+    }
+    for (uint16_t i = 0; i < slowRecordCount; ++i)
+    {
+        freeSlow[i] = fastRecordCount + slowRecordCount - 1 - i;
+    }
+    freeFastCount = fastRecordCount;
+    freeSlowCount = slowRecordCount;
+    portEXIT_CRITICAL(&recordPoolMux);
+
+    BEEPR_LOGI("Records: %u internal, %u PSRAM\n", (unsigned)fastRecordCount, (unsigned)slowRecordCount);
+}
+
+uint16_t BeeprNotifs::slowRecordCapacity()
+{
+    return slowRecordCount;
+}
+
+static uint16_t claimFromTier(bool fast)
+{
+    uint16_t index = NOTIF_NO_RECORD;
+    portENTER_CRITICAL(&recordPoolMux);
+    if (fast && freeFastCount > 0)
+    {
+        index = freeFast[--freeFastCount];
+        tierStats.fastClaims++;
+    }
+    else if (!fast && freeSlowCount > 0)
+    {
+        index = freeSlow[--freeSlowCount];
+        tierStats.slowClaims++;
+    }
+    if (index != NOTIF_NO_RECORD)
+    {
+        recordRefs[index] = 1;
+        uint16_t inUse = recordCount() - freeFastCount - freeSlowCount;
+        if (inUse > tierStats.inUseMax)
         {
-            return (int)i;
+            tierStats.inUseMax = inUse;
         }
     }
-    return -1;
+    portEXIT_CRITICAL(&recordPoolMux);
+    return index;
 }
 
-static DisplaySnapshot buildSnapshotLocked()
+uint16_t BeeprNotifs::claimRecord()
 {
-    DisplaySnapshot snapshot = {false, "", "", "", 0, 0};
-    const size_t count = notifList.size();
-    if (count == 0)
+    // With a PSRAM tier the internal records are left to the hot cache and
+    // only taken once PSRAM runs out.
+    bool fastFirst = slowRecordCount == 0;
+    uint16_t index = claimFromTier(fastFirst);
+    if (index == NOTIF_NO_RECORD)
     {
-        currentIndex = 0;
-        return snapshot;
+        index = claimFromTier(!fastFirst);
     }
-    if (currentIndex >= count)
+    if (index == NOTIF_NO_RECORD)
     {
-        currentIndex = count - 1;
+        portENTER_CRITICAL(&recordPoolMux);
+        tierStats.exhausted++;
+        portEXIT_CRITICAL(&recordPoolMux);
     }
-    const StoredNotification &n = notifList[currentIndex];
-    snapshot.hasNotification = true;
-    snapshot.app = n.app;
-    snapshot.contact = n.contact;
-    snapshot.message = n.message;
-    snapshot.current = currentIndex;
-    snapshot.total = count;
-    return snapshot;
+    return index;
 }
 
-static void renderSnapshot(const DisplaySnapshot &snapshot)
+NotifRecord *BeeprNotifs::record(uint16_t index)
 {
-    SemaphoreHandle_t d = getDisplayMutex();
-    if (!d || xSemaphoreTake(d, portMAX_DELAY) != pdTRUE)
+    if (index < fastRecordCount)
+    {
+        return &fastRecords[index];
+    }
+    return index < recordCount() ? &slowRecords[index - fastRecordCount] : nullptr;
+}
+
+void BeeprNotifs::retainRecord(uint16_t index)
+{
+    if (index >= recordCount())
     {
         return;
     }
+    portENTER_CRITICAL(&recordPoolMux);
+    recordRefs[index]++;
+    portEXIT_CRITICAL(&recordPoolMux);
+}
 
-    if (!snapshot.hasNotification)
+void BeeprNotifs::releaseRecord(uint16_t index)
+{
+    if (index >= recordCount())
     {
-        BeeprDisplay::showEmpty();
-        xSemaphoreGive(d);
         return;
     }
-    BeeprDisplay::showNotification(snapshot.app, snapshot.contact, snapshot.message,
-                                   snapshot.current, snapshot.total);
-    xSemaphoreGive(d);
+    portENTER_CRITICAL(&recordPoolMux);
+    if (recordRefs[index] > 0 && --recordRefs[index] == 0)
+    {
+        if (index < fastRecordCount)
+        {
+            freeFast[freeFastCount++] = index;
+        }
+        else
+        {
+            freeSlow[freeSlowCount++] = index;
+        }
+    }
+    portEXIT_CRITICAL(&recordPoolMux);
 }
 
-static bool removeAtLocked(size_t index, size_t *newCount, DisplaySnapshot *snapshotOut)
+const NotifView *BeeprNotifs::acquireView()
 {
-    const size_t count = notifList.size();
-    if (count == 0 || index >= count)
+    uint32_t startCycles = ESP.getCycleCount();
+    portENTER_CRITICAL(&viewMux);
+    NotifView *view = publishedView;
+    if (view)
     {
-        return false;
+        view->refs++;
     }
+    portEXIT_CRITICAL(&viewMux);
 
-    if (index < currentIndex)
+    // Any number of readers: the counters are updated atomically.
+    uint32_t cycles = ESP.getCycleCount() - startCycles;
+    __atomic_fetch_add(&storeStats.readerAcquires, 1, __ATOMIC_RELAXED);
+    statMax(storeStats.readerMaxCycles, cycles);
+    return view;
+}
+
+void BeeprNotifs::releaseView(const NotifView *view)
+{
+    if (!view)
+    {
+        return;
+    }
+    NotifView *v = const_cast<NotifView *>(view);
+    uint16_t unpinRecord = NOTIF_NO_RECORD;
+    portENTER_CRITICAL(&viewMux);
+    if (v->refs > 0 && --v->refs == 0)
     {
-        currentIndex--;
+        unpinRecord = v->record;
     }
+    portEXIT_CRITICAL(&viewMux);
+    releaseRecord(unpinRecord);
+}
 
-    notifList.erase(notifList.begin() + static_cast<std::vector<StoredNotification>::difference_type>(index));
+static NotifView *claimViewLocked()
+{
+    // Readers only pin views briefly, so a free slot turns up quickly.
+    for (;;)
+    {
+        portENTER_CRITICAL(&viewMux);
+        for (uint8_t i = 0; i < NOTIF_VIEW_POOL_SIZE; ++i)
+        {
+            if (viewPool[i].refs == 0)
+            {
+                viewPool[i].refs = 1;
+                portEXIT_CRITICAL(&viewMux);
+                return &viewPool[i];
+            }
+        }
+        portEXIT_CRITICAL(&viewMux);
+        vTaskDelay(1);
+    }
+}
+
+static void listLinkTail(IndexList &list, uint8_t slot, uint8_t StoredNotification::*prev,
+                         uint8_t StoredNotification::*next)
+{
+    slots[slot].*prev = list.tail;
+    slots[slot].*next = NO_SLOT;
+    if (list.tail != NO_SLOT)
+    {
+        slots[list.tail].*next = slot;
+    }
+    else
+    {
+        list.head = slot;
+    }
+    list.tail = slot;
+    list.count++;
+}
 
-    if (newCount)
+static void listUnlink(IndexList &list, uint8_t slot, uint8_t StoredNotification::*prev,
+                       uint8_t StoredNotification::*next)
+{
+    uint8_t p = slots[slot].*prev;
+    uint8_t n = slots[slot].*next;
+    if (p != NO_SLOT)
     {
-        *newCount = notifList.size();
+        slots[p].*next = n;
     }
-    if (snapshotOut)
+    else
     {
-        *snapshotOut = buildSnapshotLocked();
+        list.head = n;
     }
+    if (n != NO_SLOT)
+    {
+        slots[n].*prev = p;
+    }
+    else
+    {
+        list.tail = p;
+    }
+    list.count--;
+}
+
+static uint32_t fnv1a(const char *s, uint32_t hash = 2166136261UL)
+{
+    for (; *s; ++s)
+    {
+        hash ^= (uint8_t)*s;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static uint32_t appKeyFor(const char *app)
+{
+    return fnv1a(app);
+}
+
+static uint32_t contentHashFor(const NotifRecord &rec)
+{
+    // Field separators keep ("ab", "c") and ("a", "bc") apart.
+    uint32_t hash = fnv1a(rec.app);
+    hash = fnv1a("\x1f", hash);
+    hash = fnv1a(rec.title, hash);
+    hash = fnv1a("\x1f", hash);
+    return fnv1a(rec.message, hash);
+}
+
+// An open group always has entries; its app name is that of the oldest.
+static const char *groupAppLocked(uint8_t g)
+{
+    return BeeprNotifs::record(slots[groups[g].entries.head].record)->app;
+}
+
+// The key is only a hash: a hit is confirmed against the app name, so two
+// apps whose names collide keep separate groups.
+static uint8_t findGroupLocked(uint32_t key, const char *app)
+{
+    uint8_t i = key & (GROUP_TABLE_SIZE - 1);
+    while (groupTable[i] != NO_SLOT)
+    {
+        uint8_t g = groupTable[i];
+        if (groups[g].key == key && strcmp(groupAppLocked(g), app) == 0)
+        {
+            return g;
+        }
+        i = (i + 1) & (GROUP_TABLE_SIZE - 1);
+    }
+    return NO_SLOT;
+}
+
+static uint8_t openGroupLocked(uint32_t key, const char *app)
+{
+    uint8_t g = findGroupLocked(key, app);
+    if (g != NO_SLOT)
+    {
+        return g;
+    }
+
+    g = freeGroups[--freeGroupCount];
+    groups[g].key = key;
+    groups[g].entries = {NO_SLOT, NO_SLOT, 0};
+    groups[g].prev = groupOrder.tail;
+    groups[g].next = NO_SLOT;
+    if (groupOrder.tail != NO_SLOT)
+    {
+        groups[groupOrder.tail].next = g;
+    }
+    else
+    {
+        groupOrder.head = g;
+    }
+    groupOrder.tail = g;
+    groupOrder.count++;
+
+    uint8_t i = key & (GROUP_TABLE_SIZE - 1);
+    while (groupTable[i] != NO_SLOT)
+    {
+        i = (i + 1) & (GROUP_TABLE_SIZE - 1);
+    }
+    groupTable[i] = g;
+    return g;
+}
+
+static void closeGroupLocked(uint8_t g)
+{
+    AppGroup &group = groups[g];
+    if (group.prev != NO_SLOT)
+    {
+        groups[group.prev].next = group.next;
+    }
+    else
+    {
+        groupOrder.head = group.next;
+    }
+    if (group.next != NO_SLOT)
+    {
+        groups[group.next].prev = group.prev;
+    }
+    else
+    {
+        groupOrder.tail = group.prev;
+    }
+    groupOrder.count--;
+
+    // Linear-probing delete with backward shift, so lookups never need tombstones.
+    const uint8_t mask = GROUP_TABLE_SIZE - 1;
+    uint8_t i = group.key & mask;
+    while (groupTable[i] != g)
+    {
+        i = (i + 1) & mask;
+    }
+    groupTable[i] = NO_SLOT;
+    for (uint8_t j = (i + 1) & mask; groupTable[j] != NO_SLOT; j = (j + 1) & mask)
+    {
+        uint8_t home = groups[groupTable[j]].key & mask;
+        bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays)
+        {
+            groupTable[i] = groupTable[j];
+            groupTable[j] = NO_SLOT;
+            i = j;
+        }
+    }
+    freeGroups[freeGroupCount++] = g;
+}
+
+static void linkIndicesLocked(uint8_t slot)
+{
+    StoredNotification &n = slots[slot];
+    n.group = openGroupLocked(n.appKey, BeeprNotifs::record(n.record)->app);
+    listLinkTail(groups[n.group].entries, slot, &StoredNotification::appPrev, &StoredNotification::appNext);
+    listLinkTail(categoryLists[n.category], slot, &StoredNotification::catPrev, &StoredNotification::catNext);
+}
+
+static void unlinkIndicesLocked(uint8_t slot)
+{
+    StoredNotification &n = slots[slot];
+    AppGroup &group = groups[n.group];
+    listUnlink(group.entries, slot, &StoredNotification::appPrev, &StoredNotification::appNext);
+    if (group.entries.count == 0)
+    {
+        closeGroupLocked(n.group);
+    }
+    listUnlink(categoryLists[n.category], slot, &StoredNotification::catPrev, &StoredNotification::catNext);
+}
+
+static void setIndexKeysLocked(uint8_t slot, uint8_t category)
+{
+    StoredNotification &n = slots[slot];
+    n.appKey = appKeyFor(BeeprNotifs::record(n.record)->app);
+    n.category = category < NOTIF_CATEGORY_COUNT ? category : 0;
+}
+
+static uint32_t msUntil(uint32_t dueMs, uint32_t now)
+{
+    int32_t ms = (int32_t)(dueMs - now);
+    return ms > 0 ? (uint32_t)ms : 0;
+}
+
+// Deadlines only ever move earlier from other tasks (a new timer, another
+// entry on screen); the timer task picks the new one up when woken.
+static void wakeTimerTask()
+{
+    if (timerTask && xTaskGetCurrentTaskHandle() != timerTask)
+    {
+        xTaskNotifyGive(timerTask);
+    }
+}
+
+static void noteExpiryDeadlineLocked(uint32_t now)
+{
+    uint32_t ms = BeeprTtlWheel::msUntilNext(ttlWheel, now);
+    expiryDueMs = now + ms;
+    expiryArmed = ms != TTL_NO_DEADLINE;
+}
+
+// (Re)starts a slot's expiry from its category TTL; O(1).
+static void armExpiryLocked(uint8_t slot, uint32_t now)
+{
+    uint16_t minutes = categoryTtlMin[slots[slot].category];
+    if (minutes == 0)
+    {
+        BeeprTtlWheel::cancel(ttlWheel, slot);
+        return;
+    }
+    BeeprTtlWheel::arm(ttlWheel, slot, minutes * 60000UL, now);
+    noteExpiryDeadlineLocked(now);
+}
+
+// Called with the display mutex held.
+static void noteAgeDeadline(uint32_t validMs, uint32_t now)
+{
+    ageDueMs = now + validMs;
+    ageArmed = validMs != NO_DEADLINE;
+}
+
+static bool isHotRecord(uint16_t record)
+{
+    return slowRecordCount > 0 && record < fastRecordCount;
+}
+
+// Every change of a slot's record goes through here, so a slot is on
+// hotOrder exactly while it holds an internal record.
+static void setSlotRecordLocked(uint8_t slot, uint16_t record)
+{
+    StoredNotification &n = slots[slot];
+    if (isHotRecord(n.record))
+    {
+        listUnlink(hotOrder, slot, &StoredNotification::hotPrev, &StoredNotification::hotNext);
+    }
+    n.record = record;
+    if (isHotRecord(record))
+    {
+        listLinkTail(hotOrder, slot, &StoredNotification::hotPrev, &StoredNotification::hotNext);
+    }
+}
+
+// Copies a slot's text into a record of the other tier. The old record is
+// released; a view still showing it keeps it until the view is released.
+static bool moveSlotRecordLocked(uint8_t slot, bool toFast)
+{
+    uint16_t from = slots[slot].record;
+    uint16_t to = claimFromTier(toFast);
+    if (to == NOTIF_NO_RECORD)
+    {
+        return false;
+    }
+    memcpy(BeeprNotifs::record(to), BeeprNotifs::record(from), sizeof(NotifRecord));
+    setSlotRecordLocked(slot, to);
+    BeeprNotifs::releaseRecord(from);
     return true;
 }
 
-void BeeprNotifs::showCurrent()
+// Marks a slot as just used, copying it into the internal tier if needed.
+// A full cache sends its least recently used entry back to PSRAM first. One
+// internal record is kept spare: the published view still pins the old
+// record of an entry just edited or removed on screen. A reader pinning
+// more makes this a miss, and the next touch tries again. O(1).
+static void touchHotLocked(uint8_t slot)
 {
-    SemaphoreHandle_t m = getNotifMutex();
-    if (!m)
+    if (slowRecordCount == 0 || slot == NO_SLOT)
     {
-        BeeprDisplay::showEmpty();
         return;
     }
+    if (isHotRecord(slots[slot].record))
+    {
+        listUnlink(hotOrder, slot, &StoredNotification::hotPrev, &StoredNotification::hotNext);
+        listLinkTail(hotOrder, slot, &StoredNotification::hotPrev, &StoredNotification::hotNext);
+        return;
+    }
+    if (hotOrder.count >= NOTIF_HOT_ENTRIES && moveSlotRecordLocked(hotOrder.head, false))
+    {
+        tierStats.demotions++;
+    }
+    if (moveSlotRecordLocked(slot, true))
+    {
+        tierStats.promotions++;
+        return;
+    }
+    tierStats.promoteMisses++;
+}
 
-    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+// Unlinks a slot from every list and frees it; O(1).
+static void removeSlotLocked(uint8_t slot, bool expired = false)
+{
+    if (currentSlot == slot)
+    {
+        // Keep the pager on the following entry, like erasing from a list.
+        uint8_t successor = slots[slot].next != NO_SLOT ? slots[slot].next : slots[slot].prev;
+        currentSlot = successor;
+    }
+    unlinkIndicesLocked(slot);
+    listUnlink(storeOrder, slot, &StoredNotification::prev, &StoredNotification::next);
+    BeeprTtlWheel::cancel(ttlWheel, slot);
+    BeeprNotifs::releaseRecord(slots[slot].record);
+    setSlotRecordLocked(slot, NOTIF_NO_RECORD);
+    freeSlots[freeSlotCount++] = slot;
+    BeeprFlightRec::record(FlightStoreRemove, expired ? 1 : 0, (uint16_t)storeOrder.count);
+}
+
+static uint8_t findSlotByUidLocked(uint32_t uid)
+{
+    for (uint8_t s = storeOrder.head; s != NO_SLOT; s = slots[s].next)
+    {
+        if (slots[s].uid == uid)
+        {
+            return s;
+        }
+    }
+    return NO_SLOT;
+}
+
+// Builds a view of the store and swaps it in. Called with the store mutex held.
+static void publishViewLocked()
+{
+    if (currentSlot == NO_SLOT)
+    {
+        currentSlot = storeOrder.head;
+    }
+    // Current last, so it is the most recently used and the view pins the
+    // internal copy.
+    touchHotLocked(storeOrder.tail);
+    touchHotLocked(currentSlot);
+
+    NotifView *view = claimViewLocked();
+    view->hasNotification = currentSlot != NO_SLOT;
+    view->record = view->hasNotification ? slots[currentSlot].record : NOTIF_NO_RECORD;
+    view->uid = view->hasNotification ? slots[currentSlot].uid : 0;
+    view->arrivedMs = view->hasNotification ? slots[currentSlot].arrivedMs : 0;
+    view->appCount = view->hasNotification ? groups[slots[currentSlot].group].entries.count : 0;
+    view->appGroups = groupOrder.count;
+    view->total = storeOrder.count;
+    view->current = 0;
+    uint16_t i = 0;
+    for (uint8_t s = storeOrder.head; s != NO_SLOT; s = slots[s].next, ++i)
+    {
+        view->uids[i] = slots[s].uid;
+        if (s == currentSlot)
+        {
+            view->current = i;
+        }
+    }
+    for (uint8_t c = 0; c < NOTIF_CATEGORY_COUNT; ++c)
+    {
+        view->categoryCounts[c] = categoryLists[c].count;
+    }
+    BeeprNotifs::retainRecord(view->record);
+
+    portENTER_CRITICAL(&viewMux);
+    NotifView *previous = publishedView;
+    publishedView = view;
+    portEXIT_CRITICAL(&viewMux);
+
+    storeStats.viewsPublished++;
+    BeeprNotifs::releaseView(previous);
+}
+
+// Renders whatever view is current when the display is free, so concurrent
+// writers can't leave an older frame on screen.
+static void renderLatest()
+{
+    if (benchRunning)
     {
-        BeeprDisplay::showEmpty();
         return;
     }
-    DisplaySnapshot snapshot = buildSnapshotLocked();
-    xSemaphoreGive(m);
-    renderSnapshot(snapshot);
+    SemaphoreHandle_t d = getDisplayMutex();
+    if (!d || xSemaphoreTake(d, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+
+    const NotifView *view = BeeprNotifs::acquireView();
+    const NotifRecord *rec = view ? BeeprNotifs::record(view->record) : nullptr;
+    uint32_t now = millis();
+    if (!view || !view->hasNotification || !rec)
+    {
+        BeeprDisplay::showEmpty();
+        ageArmed = false;
+    }
+    else
+    {
+        uint32_t ageMs = now - view->arrivedMs;
+        BeeprDisplay::showNotification(rec->app, rec->title, rec->message, view->appCount,
+                                       view->current, view->total, ageMs);
+        noteAgeDeadline(BeeprDisplay::refreshAge(ageMs), now);
+    }
+    BeeprNotifs::releaseView(view);
+    xSemaphoreGive(d);
+    if (ageArmed)
+    {
+        wakeTimerTask();
+    }
 }
 
-void BeeprNotifs::add(const String &app, const String &contact, const String &message, uint32_t uuid)
+void BeeprNotifs::showCurrent()
 {
-    SemaphoreHandle_t m = getNotifMutex();
-    if (!m)
+    renderLatest();
+}
+
+void BeeprNotifs::add(uint16_t record, uint32_t uuid, uint8_t category)
+{
+    const NotifRecord *rec = BeeprNotifs::record(record);
+    if (!rec)
     {
         return;
     }
 
-    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+    // Hash outside the lock; the record is still private to this caller.
+    uint32_t contentHash = contentHashFor(*rec);
+    uint8_t alert = BeeprAlert::patternFor(category, rec->app);
+    SemaphoreHandle_t m = lockStore();
+    if (!m)
     {
+        releaseRecord(record);
         return;
     }
 
-    int existingIndex = findIndexByUidLocked(uuid);
-    if (existingIndex >= 0)
+    uint32_t now = millis();
+    uint8_t slot = findSlotByUidLocked(uuid);
+    if (slot != NO_SLOT && slots[slot].contentHash == contentHash && slots[slot].category == category)
+    {
+        // iOS re-sent an identical notification (reconnect, badge change):
+        // keep the stored record, the pager position and the screen as they
+        // are. The phone still has it, so it has not gone stale.
+        storeStats.duplicateUpdates++;
+        armExpiryLocked(slot, now);
+        xSemaphoreGive(m);
+        releaseRecord(record);
+        return;
+    }
+    if (slot != NO_SLOT)
     {
-        StoredNotification &n = notifList[(size_t)existingIndex];
-        n.app = app;
-        n.contact = contact;
-        n.message = message;
-        currentIndex = (size_t)existingIndex;
+        // Records are immutable once published: swap in the new one and
+        // re-key the secondary indices, the app or category may have changed.
+        StoredNotification &n = slots[slot];
+        unlinkIndicesLocked(slot);
+        releaseRecord(n.record);
+        setSlotRecordLocked(slot, record);
+        n.contentHash = contentHash;
+        n.arrivedMs = now;
+        setIndexKeysLocked(slot, category);
+        linkIndicesLocked(slot);
     }
     else
     {
-        notifList.push_back({app, contact, message, uuid});
-        currentIndex = notifList.size() - 1;
+        if (storeOrder.count >= NOTIF_STORE_CAPACITY)
+        {
+            // Store full: evict the oldest entry.
+            removeSlotLocked(storeOrder.head);
+        }
+        slot = freeSlots[--freeSlotCount];
+        StoredNotification &n = slots[slot];
+        n.uid = uuid;
+        setSlotRecordLocked(slot, record);
+        n.contentHash = contentHash;
+        n.arrivedMs = now;
+        setIndexKeysLocked(slot, category);
+        listLinkTail(storeOrder, slot, &StoredNotification::prev, &StoredNotification::next);
+        linkIndicesLocked(slot);
     }
+    armExpiryLocked(slot, now);
+    currentSlot = slot;
 
-    size_t count = notifList.size();
-    DisplaySnapshot snapshot = buildSnapshotLocked();
+    size_t count = storeOrder.count;
+    publishViewLocked();
     xSemaphoreGive(m);
 
-    Serial.printf("Local notifications: %u\n", (unsigned)count);
-    renderSnapshot(snapshot);
+    wakeTimerTask();
+    BeeprFlightRec::record(FlightStoreAdd, 0, (uint16_t)count);
+    BEEPR_LOGI("Local notifications: %u\n", (unsigned)count);
+    // Only genuinely new content wakes the panel; duplicates returned above.
+    if (!benchRunning || uuid - BENCH_UID_BASE >= BENCH_UIDS)
+    {
+        BeeprPower::noteNotification();
+        BeeprAlert::play(alert);
+    }
+    renderLatest();
 }
 
 bool BeeprNotifs::removeAt(size_t index)
 {
-    SemaphoreHandle_t m = getNotifMutex();
+    SemaphoreHandle_t m = lockStore();
     if (!m)
     {
         return false;
     }
 
-    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+    uint8_t slot = storeOrder.head;
+    for (size_t i = 0; i < index && slot != NO_SLOT; ++i)
     {
-        return false;
+        slot = slots[slot].next;
     }
-
-    size_t newCount = 0;
-    DisplaySnapshot snapshot = {false, "", "", "", 0, 0};
-    bool removed = removeAtLocked(index, &newCount, &snapshot);
-    xSemaphoreGive(m);
-
-    if (!removed)
+    if (slot == NO_SLOT)
     {
+        xSemaphoreGive(m);
         return false;
     }
 
-    Serial.printf("Local notifications: %u\n", (unsigned)newCount);
-    renderSnapshot(snapshot);
+    removeSlotLocked(slot);
+    size_t newCount = storeOrder.count;
+    publishViewLocked();
+    xSemaphoreGive(m);
+
+    BEEPR_LOGI("Local notifications: %u\n", (unsigned)newCount);
+    renderLatest();
     return true;
 }
 
 void BeeprNotifs::removeCurrent()
 {
     // Remove the currently displayed notification.
-    if (removeAt(currentIndex))
+    SemaphoreHandle_t m = lockStore();
+    if (!m)
     {
-        Serial.println("Local notification removed");
+        return;
     }
-    else
+
+    if (currentSlot == NO_SLOT)
     {
-        Serial.println("Remove skipped (no notifications)");
+        xSemaphoreGive(m);
+        BEEPR_LOGI("Remove skipped (no notifications)\n");
+        return;
     }
+
+    removeSlotLocked(currentSlot);
+    size_t newCount = storeOrder.count;
+    publishViewLocked();
+    xSemaphoreGive(m);
+
+    BEEPR_LOGI("Local notifications: %u\n", (unsigned)newCount);
+    BEEPR_LOGI("Local notification removed\n");
+    renderLatest();
 }
 
-int BeeprNotifs::findIndexByUid(uint32_t uid)
+size_t BeeprNotifs::clearCurrentApp()
 {
-    SemaphoreHandle_t m = getNotifMutex();
+    // Walks only the current app's group: O(k) in its size.
+    SemaphoreHandle_t m = lockStore();
     if (!m)
     {
-        return -1;
+        return 0;
     }
 
-    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+    size_t removed = 0;
+    if (currentSlot != NO_SLOT)
     {
-        return -1;
+        uint8_t g = slots[currentSlot].group;
+        // Land on the newest entry of the next app once this group is gone.
+        uint8_t nextGroup = groups[g].next != NO_SLOT ? groups[g].next : groupOrder.head;
+        uint8_t resumeSlot = nextGroup != g ? groups[nextGroup].entries.tail : NO_SLOT;
+        removed = groups[g].entries.count;
+        for (size_t i = 0; i < removed; ++i)
+        {
+            removeSlotLocked(groups[g].entries.head);
+        }
+        currentSlot = resumeSlot;
     }
-    int idx = findIndexByUidLocked(uid);
+
+    size_t newCount = storeOrder.count;
+    publishViewLocked();
     xSemaphoreGive(m);
+
+    BEEPR_LOGI("Cleared %u notification(s) from app, local notifications: %u\n",
+               (unsigned)removed, (unsigned)newCount);
+    renderLatest();
+    return removed;
+}
+
+int BeeprNotifs::findIndexByUid(uint32_t uid)
+{
+    // Answered from the published view, without the store mutex.
+    const NotifView *view = acquireView();
+    if (!view)
+    {
+        return -1;
+    }
+    int idx = -1;
+    for (uint16_t i = 0; i < view->total; ++i)
+    {
+        if (view->uids[i] == uid)
+        {
+            idx = i;
+            break;
+        }
+    }
+    releaseView(view);
     return idx;
 }
 
-bool BeeprNotifs::removeByUid(uint32_t uid)
+bool BeeprNotifs::retainEntry(size_t index, NotifEntry &entry)
 {
-    // Used by ANCS "Removed" events to keep local list in sync.
+    // Read-only walk: takes the store mutex directly so it does not show up
+    // as writer contention.
     SemaphoreHandle_t m = getNotifMutex();
-    if (!m)
+    if (!m || xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
     {
         return false;
     }
-    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+
+    uint8_t slot = storeOrder.head;
+    for (size_t i = 0; i < index && slot != NO_SLOT; ++i)
+    {
+        slot = slots[slot].next;
+    }
+    bool found = slot != NO_SLOT;
+    if (found)
+    {
+        entry.uid = slots[slot].uid;
+        entry.category = slots[slot].category;
+        entry.record = slots[slot].record;
+        retainRecord(entry.record);
+    }
+    xSemaphoreGive(m);
+    return found;
+}
+
+uint32_t BeeprNotifs::duplicateUpdates()
+{
+    return storeStats.duplicateUpdates;
+}
+
+bool BeeprNotifs::removeByUid(uint32_t uid)
+{
+    // Used by ANCS "Removed" events to keep local list in sync.
+    SemaphoreHandle_t m = lockStore();
+    if (!m)
     {
         return false;
     }
 
-    int idx = findIndexByUidLocked(uid);
-    if (idx < 0)
+    uint8_t slot = findSlotByUidLocked(uid);
+    if (slot == NO_SLOT)
     {
         xSemaphoreGive(m);
         return false;
     }
 
-    size_t newCount = 0;
-    DisplaySnapshot snapshot = {false, "", "", "", 0, 0};
-    bool removed = removeAtLocked((size_t)idx, &newCount, &snapshot);
+    removeSlotLocked(slot);
+    size_t newCount = storeOrder.count;
+    publishViewLocked();
     xSemaphoreGive(m);
 
-    if (!removed)
+    BEEPR_LOGI("Local notifications: %u\n", (unsigned)newCount);
+    renderLatest();
+    return true;
+}
+
+void BeeprNotifs::next()
+{
+    SemaphoreHandle_t m = lockStore();
+    if (!m)
     {
-        return false;
+        return;
     }
 
-    Serial.printf("Local notifications: %u\n", (unsigned)newCount);
-    renderSnapshot(snapshot);
-    return true;
+    if (currentSlot == NO_SLOT)
+    {
+        xSemaphoreGive(m);
+        return;
+    }
+    currentSlot = slots[currentSlot].next != NO_SLOT ? slots[currentSlot].next : storeOrder.head;
+    publishViewLocked();
+    xSemaphoreGive(m);
+    renderLatest();
 }
 
-void BeeprNotifs::next()
+void BeeprNotifs::nextApp()
 {
-    SemaphoreHandle_t m = getNotifMutex();
+    // Jumps to the newest entry of the next app group: O(1).
+    SemaphoreHandle_t m = lockStore();
     if (!m)
     {
         return;
     }
-    if (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE)
+
+    if (currentSlot == NO_SLOT)
     {
+        xSemaphoreGive(m);
         return;
     }
+    uint8_t g = slots[currentSlot].group;
+    uint8_t nextGroup = groups[g].next != NO_SLOT ? groups[g].next : groupOrder.head;
+    currentSlot = groups[nextGroup].entries.tail;
+    publishViewLocked();
+    xSemaphoreGive(m);
+    renderLatest();
+}
 
-    const size_t count = notifList.size();
-    if (count == 0)
+void BeeprNotifs::printStats()
+{
+    uint32_t avgWaitUs = storeStats.writerOps ? (uint32_t)(storeStats.writerWaitUsTotal / storeStats.writerOps) : 0;
+    Serial.printf("Store: writer ops=%lu wait avg=%luus max=%luus views=%lu\n",
+                  (unsigned long)storeStats.writerOps, (unsigned long)avgWaitUs,
+                  (unsigned long)storeStats.writerWaitUsMax, (unsigned long)storeStats.viewsPublished);
+    Serial.printf("Store: reader acquires=%lu max=%lu cycles\n",
+                  (unsigned long)storeStats.readerAcquires, (unsigned long)storeStats.readerMaxCycles);
+    Serial.printf("Store: duplicate updates suppressed=%lu\n", (unsigned long)storeStats.duplicateUpdates);
+
+    SemaphoreHandle_t m = getNotifMutex();
+    if (m && xSemaphoreTake(m, portMAX_DELAY) == pdTRUE)
     {
+        TtlWheel w = ttlWheel;
         xSemaphoreGive(m);
+        uint32_t nextMs = BeeprTtlWheel::msUntilNext(w, millis());
+        Serial.printf("Store: expiry timers armed=%u arms=%lu cancels=%lu cascaded=%lu steps=%lu, expired=%lu in %lu batch(es)",
+                      (unsigned)w.armed, (unsigned long)w.arms, (unsigned long)w.cancels,
+                      (unsigned long)w.cascaded, (unsigned long)w.steps, (unsigned long)expiredTotal,
+                      (unsigned long)expiryBatches);
+        if (nextMs != TTL_NO_DEADLINE)
+        {
+            Serial.printf(", next check in %lus", (unsigned long)(nextMs / 1000));
+        }
+        Serial.println();
+    }
+
+    const NotifView *view = acquireView();
+    if (!view)
+    {
+        return;
+    }
+    Serial.printf("Store: %u entries from %u app(s), by category:", (unsigned)view->total,
+                  (unsigned)view->appGroups);
+    for (uint8_t c = 0; c < NOTIF_CATEGORY_COUNT; ++c)
+    {
+        if (view->categoryCounts[c])
+        {
+            Serial.printf(" %u=%u", (unsigned)c, (unsigned)view->categoryCounts[c]);
+        }
+    }
+    Serial.println();
+    releaseView(view);
+}
+
+// Average cycles to copy one record out of a tier. Strided over the tier so
+// most copies miss the cache, which is what paging through old entries costs.
+// Records may be rewritten concurrently; only the timing matters here.
+static uint32_t measureCopyCycles(const NotifRecord *tier, uint16_t count)
+{
+    static NotifRecord scratch;
+    if (!tier || count == 0)
+    {
+        return 0;
+    }
+    uint16_t samples = count < 32 ? count : 32;
+    uint16_t stride = count / samples;
+    uint32_t start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < samples; ++i)
+    {
+        memcpy(&scratch, &tier[i * stride], sizeof(scratch));
+    }
+    return (ESP.getCycleCount() - start) / samples;
+}
+
+void BeeprNotifs::printTierStats()
+{
+    portENTER_CRITICAL(&recordPoolMux);
+    RecordTierStats s = tierStats;
+    uint16_t fastFree = freeFastCount;
+    uint16_t slowFree = freeSlowCount;
+    portEXIT_CRITICAL(&recordPoolMux);
+
+    Serial.printf("Records: internal %u/%u used, PSRAM %u/%u used, peak %u\n",
+                  (unsigned)(fastRecordCount - fastFree), (unsigned)fastRecordCount,
+                  (unsigned)(slowRecordCount - slowFree), (unsigned)slowRecordCount, (unsigned)s.inUseMax);
+    Serial.printf("Records: claims internal=%lu PSRAM=%lu exhausted=%lu\n",
+                  (unsigned long)s.fastClaims, (unsigned long)s.slowClaims, (unsigned long)s.exhausted);
+    Serial.printf("Records: hot entries=%u promotions=%lu demotions=%lu misses=%lu\n", (unsigned)hotOrder.count,
+                  (unsigned long)s.promotions, (unsigned long)s.demotions, (unsigned long)s.promoteMisses);
+    Serial.printf("Records: copy cost internal=%lu PSRAM=%lu cycles/record\n",
+                  (unsigned long)measureCopyCycles(fastRecords, fastRecordCount),
+                  (unsigned long)measureCopyCycles(slowRecords, slowRecordCount));
+}
+
+// Contention bench: a BLE-like writer adds and removes synthetic entries and
+// a button-like pager steps through them, both on the store mutex, while a
+// renderer-like reader only pins published views.
+struct BenchRun
+{
+    uint32_t reads;
+    uint32_t readMaxCycles;
+    uint32_t writeMaxUs;
+    uint32_t pages;
+    uint32_t tasksLeft;
+    uint32_t startMs;
+    StoreStats before;
+};
+
+static BenchRun benchRun;
+
+// The last bench task to finish reports and puts the screen back.
+static void benchTaskDone()
+{
+    if (__atomic_sub_fetch(&benchRun.tasksLeft, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        vTaskDelete(nullptr);
+        return;
+    }
+    const BenchRun &r = benchRun;
+    uint32_t ms = millis() - r.startMs;
+    uint32_t ops = storeStats.writerOps - r.before.writerOps;
+    uint64_t waitUs = storeStats.writerWaitUsTotal - r.before.writerWaitUsTotal;
+    Serial.printf("Bench done in %lums: %lu writer ops (%lu pages), lock wait avg=%luus, op max=%luus\n",
+                  (unsigned long)ms, (unsigned long)ops, (unsigned long)r.pages,
+                  (unsigned long)(ops ? waitUs / ops : 0), (unsigned long)r.writeMaxUs);
+    Serial.printf("Bench reader: %lu view reads, acquire max=%lu cycles\n", (unsigned long)r.reads,
+                  (unsigned long)r.readMaxCycles);
+    benchRunning = false;
+    renderLatest();
+    vTaskDelete(nullptr);
+}
+
+static void benchWriterTask(void *param)
+{
+    uint16_t iterations = (uint16_t)(uintptr_t)param;
+    for (uint16_t i = 0; i < iterations; ++i)
+    {
+        uint32_t uid = BENCH_UID_BASE | (i % BENCH_UIDS);
+        uint32_t startUs = micros();
+        uint16_t index = BeeprNotifs::claimRecord();
+        NotifRecord *rec = BeeprNotifs::record(index);
+        if (rec)
+        {
+            snprintf(rec->app, sizeof(rec->app), "Bench");
+            snprintf(rec->title, sizeof(rec->title), "Writer %u", (unsigned)i);
+            rec->message[0] = '\0';
+            BeeprNotifs::add(index, uid, 0);
+        }
+        if (i % 2)
+        {
+            BeeprNotifs::removeByUid(uid);
+        }
+        statMax(benchRun.writeMaxUs, micros() - startUs);
+    }
+    for (uint32_t i = 0; i < BENCH_UIDS; ++i)
+    {
+        BeeprNotifs::removeByUid(BENCH_UID_BASE | i);
+    }
+    benchWriterDone = true;
+    benchTaskDone();
+}
+
+static void benchPagerTask(void *param)
+{
+    (void)param;
+    while (!benchWriterDone)
+    {
+        BeeprNotifs::next();
+        __atomic_fetch_add(&benchRun.pages, 1, __ATOMIC_RELAXED);
+        vTaskDelay(1);
+    }
+    benchTaskDone();
+}
+
+// What the renderer and status queries do: pin the published view, look at
+// it, let go. Never the store mutex, never a text copy.
+static void benchReaderTask(void *param)
+{
+    (void)param;
+    uint32_t reads = 0;
+    while (!benchWriterDone)
+    {
+        uint32_t startCycles = ESP.getCycleCount();
+        const NotifView *view = BeeprNotifs::acquireView();
+        statMax(benchRun.readMaxCycles, ESP.getCycleCount() - startCycles);
+        volatile size_t total = view ? view->total : 0;
+        (void)total;
+        BeeprNotifs::releaseView(view);
+        __atomic_fetch_add(&benchRun.reads, 1, __ATOMIC_RELAXED);
+        // Let lower-priority work on this core run now and then.
+        if (++reads % 256 == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+    benchTaskDone();
+}
+
+void BeeprNotifs::attachTimerTask(TaskHandle_t task)
+{
+    timerTask = task;
+}
+
+// Evicts every entry whose timer has fired, then publishes and renders once
+// for the whole batch.
+static void expireDue(uint32_t now)
+{
+    SemaphoreHandle_t m = lockStore();
+    if (!m)
+    {
         return;
     }
-    currentIndex = (currentIndex + 1) % count;
-    DisplaySnapshot snapshot = buildSnapshotLocked();
+
+    uint8_t fired[TTL_WHEEL_TIMERS];
+    uint8_t count = BeeprTtlWheel::advance(ttlWheel, now, fired);
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        removeSlotLocked(fired[i], true);
+    }
+    noteExpiryDeadlineLocked(now);
+    size_t newCount = storeOrder.count;
+    if (count > 0)
+    {
+        publishViewLocked();
+    }
     xSemaphoreGive(m);
-    renderSnapshot(snapshot);
+    if (count == 0)
+    {
+        return;
+    }
+
+    expiredTotal += count;
+    expiryBatches++;
+    BEEPR_LOGI("Expired %u notification(s), local notifications: %u\n", (unsigned)count, (unsigned)newCount);
+    renderLatest();
+}
+
+// Redraws the age of the entry on screen if its text changed.
+static void refreshAge(uint32_t now)
+{
+    SemaphoreHandle_t d = getDisplayMutex();
+    if (!d || xSemaphoreTake(d, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+    const NotifView *view = BeeprNotifs::acquireView();
+    if (view && view->hasNotification)
+    {
+        noteAgeDeadline(BeeprDisplay::refreshAge(now - view->arrivedMs), now);
+    }
+    else
+    {
+        ageArmed = false;
+    }
+    BeeprNotifs::releaseView(view);
+    xSemaphoreGive(d);
+}
+
+uint32_t BeeprNotifs::update()
+{
+    uint32_t now = millis();
+    if (expiryArmed && msUntil(expiryDueMs, now) == 0)
+    {
+        expireDue(now);
+    }
+    if (ageArmed && msUntil(ageDueMs, now) == 0)
+    {
+        refreshAge(now);
+    }
+
+    uint32_t waitMs = expiryArmed ? msUntil(expiryDueMs, now) : NO_DEADLINE;
+    if (ageArmed)
+    {
+        uint32_t ageMs = msUntil(ageDueMs, now);
+        waitMs = ageMs < waitMs ? ageMs : waitMs;
+    }
+    return waitMs;
+}
+
+bool BeeprNotifs::runContentionBench(uint16_t iterations)
+{
+    SemaphoreHandle_t m = lockStore();
+    if (!m)
+    {
+        return false;
+    }
+    // The bench shares the one store: it must not evict or reorder real
+    // entries, so it only runs on an empty one.
+    bool idle = storeOrder.count == 0 && !benchRunning;
+    if (idle)
+    {
+        benchRunning = true;
+        benchWriterDone = false;
+        memset(&benchRun, 0, sizeof(benchRun));
+        benchRun.before = storeStats;
+        benchRun.tasksLeft = 3;
+        benchRun.startMs = millis();
+    }
+    xSemaphoreGive(m);
+    if (!idle)
+    {
+        Serial.println("Store bench needs an empty store and no bench running");
+        return false;
+    }
+
+    Serial.printf("Store bench: %u writer iterations\n", (unsigned)iterations);
+    xTaskCreatePinnedToCore(benchWriterTask, "bench_writer", 4096, (void *)(uintptr_t)iterations, 2, nullptr, 0);
+    xTaskCreatePinnedToCore(benchPagerTask, "bench_pager", 4096, nullptr, 3, nullptr, 1);
+    xTaskCreatePinnedToCore(benchReaderTask, "bench_reader", 4096, nullptr, 2, nullptr, 1);
+    return true;
 }
@@ -2,16 +2,89 @@
 #define BEEPR_NOTIFS_H
 
 #include <Arduino.h>
+#include "beepr_config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Text of one notification. Records live in a fixed pool: ingest claims one,
+// fills it once from the ANCS buffers and passes its index through the event
+// lanes; the store then adopts it as-is. Text is only copied again to move a
+// store entry between the PSRAM and internal tiers.
+struct NotifRecord
+{
+    char app[NOTIF_APP_LEN];
+    char title[NOTIF_TITLE_LEN];
+    char message[NOTIF_MESSAGE_LEN];
+};
+
+static const uint16_t NOTIF_NO_RECORD = 0xFFFF;
+static const uint8_t NOTIF_CATEGORY_COUNT = 12; // ANCS NotificationCategory values.
+
+// Immutable view of the store, republished after every mutation. Readers
+// pin it with acquireView() (a few cycles under a spinlock, never the store
+// mutex) and read text straight from the pinned record: no copies, and
+// writers are never blocked by a slow reader such as an I2C render.
+struct NotifView
+{
+    uint8_t refs;
+    bool hasNotification;
+    uint16_t record;
+    uint32_t uid;
+    uint32_t arrivedMs;
+    uint16_t current;
+    uint16_t total;
+    uint8_t appCount;   // Entries from the current entry's app.
+    uint8_t appGroups;  // Distinct apps in the store.
+    uint8_t categoryCounts[NOTIF_CATEGORY_COUNT];
+    uint32_t uids[NOTIF_STORE_CAPACITY];
+};
+
+// One stored entry, for bulk dumps. The record is retained for the caller.
+struct NotifEntry
+{
+    uint32_t uid;
+    uint8_t category;
+    uint16_t record;
+};
 
 namespace BeeprNotifs
 {
-    void add(const String &app, const String &contact, const String &message, uint32_t uuid);
+    // Allocates the record tiers; call once from setup() before BLE starts.
+    void begin();
+    // PSRAM records beyond the regular pool (0 without PSRAM).
+    uint16_t slowRecordCapacity();
+    uint16_t claimRecord();
+    NotifRecord *record(uint16_t index);
+    void retainRecord(uint16_t index);
+    void releaseRecord(uint16_t index);
+
+    const NotifView *acquireView();
+    void releaseView(const NotifView *view);
+
+    // Takes ownership of the record.
+    void add(uint16_t record, uint32_t uuid, uint8_t category);
     void removeCurrent();
+    size_t clearCurrentApp();
     bool removeAt(size_t index);
     int findIndexByUid(uint32_t uid);
+    // Oldest first; release entry.record when done.
+    bool retainEntry(size_t index, NotifEntry &entry);
+    uint32_t duplicateUpdates();
     bool removeByUid(uint32_t uid);
     void next();
+    void nextApp();
     void showCurrent();
+    void printStats();
+    void printTierStats();
+    // Refuses (false) unless the store is empty; reports on Serial when done.
+    bool runContentionBench(uint16_t iterations);
+
+    // Expiry and the on-screen age. The attached task is woken when a
+    // deadline may have moved earlier; it calls update() at the deadline.
+    void attachTimerTask(TaskHandle_t task);
+    // Evicts expired entries (one render for the batch) and refreshes the
+    // age on screen. Returns ms until the next deadline, 0xFFFFFFFF if none.
+    uint32_t update();
 }
 
 #endif
@@ -0,0 +1,129 @@
+#ifndef BEEPR_PANEL_H
+#define BEEPR_PANEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "beepr_glyph_atlas.h"
+
+// Display backends, dispatched at compile time (CRTP): the composition code
+// is written against BeeprPanel<Derived> and every call inlines straight
+// into the backend, with no vtable. A backend supplies (as public members,
+// named apart from the wrappers so a missing one fails to compile):
+//
+//   static const int16_t WIDTH, HEIGHT;    HEIGHT a multiple of 8
+//   void panelBegin();
+//   uint8_t *panelFrame();                 page-organized, WIDTH * HEIGHT / 8 bytes
+//   void panelTransfer();                  push the whole frame
+//   void panelTransferRows(uint8_t tileRow, uint8_t tileRows);
+//   void panelPowerSave(bool enable);
+//   int16_t panelMeasure(const char *text);
+//   void panelDrawText(int16_t x, int16_t baseline, const char *text);  used without an atlas
+//
+// No Arduino dependencies here, so the framebuffer backend runs on a host.
+template <class Derived>
+class BeeprPanel
+{
+public:
+    BeeprPanel() : glyphs(nullptr)
+    {
+    }
+
+    static size_t frameBytes()
+    {
+        return (size_t)Derived::WIDTH * Derived::HEIGHT / 8;
+    }
+
+    void begin()
+    {
+        self().panelBegin();
+    }
+
+    uint8_t *frame()
+    {
+        return self().panelFrame();
+    }
+
+    void clear()
+    {
+        memset(self().panelFrame(), 0, frameBytes());
+    }
+
+    // Clears a rectangle, clipped to the frame.
+    void clearBox(int16_t x, int16_t y, int16_t w, int16_t h)
+    {
+        // Copied first: a static const member in ?: could need a definition.
+        const int16_t width = Derived::WIDTH;
+        const int16_t height = Derived::HEIGHT;
+        int16_t x1 = x + w > width ? width : x + w;
+        int16_t y1 = y + h > height ? height : y + h;
+        x = x < 0 ? 0 : x;
+        y = y < 0 ? 0 : y;
+        uint8_t *buffer = self().panelFrame();
+        for (int16_t row = y; row < y1;)
+        {
+            int16_t page = row >> 3;
+            int16_t pageEnd = (page + 1) * 8 < y1 ? (page + 1) * 8 : y1;
+            uint8_t keep = (uint8_t)~(((1u << (pageEnd - row)) - 1) << (row & 7));
+            uint8_t *p = buffer + page * width;
+            for (int16_t col = x; col < x1; col++)
+            {
+                p[col] &= keep;
+            }
+            row = pageEnd;
+        }
+    }
+
+    void setAtlas(const GlyphAtlas *atlas)
+    {
+        glyphs = atlas;
+    }
+
+    const GlyphAtlas *atlas() const
+    {
+        return glyphs;
+    }
+
+    void drawText(int16_t x, int16_t baseline, const char *text)
+    {
+        if (glyphs)
+        {
+            BeeprGlyphAtlas::drawText(*glyphs, self().panelFrame(), Derived::WIDTH, Derived::HEIGHT / 8, x, baseline,
+                                      text);
+        }
+        else
+        {
+            self().panelDrawText(x, baseline, text);
+        }
+    }
+
+    int16_t textWidth(const char *text)
+    {
+        return self().panelMeasure(text);
+    }
+
+    void transfer()
+    {
+        self().panelTransfer();
+    }
+
+    void transferRows(uint8_t tileRow, uint8_t tileRows)
+    {
+        self().panelTransferRows(tileRow, tileRows);
+    }
+
+    void powerSave(bool enable)
+    {
+        self().panelPowerSave(enable);
+    }
+
+private:
+    Derived &self()
+    {
+        return *static_cast<Derived *>(this);
+    }
+
+    const GlyphAtlas *glyphs;
+};
+
+#endif
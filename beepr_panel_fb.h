@@ -0,0 +1,201 @@
+#ifndef BEEPR_PANEL_FB_H
+#define BEEPR_PANEL_FB_H
+
+#include <stdio.h>
+#include "beepr_panel.h"
+
+// In-memory panel for host builds: frames stay in RAM, transfers are only
+// counted, and writePbm() or writePng() saves the current frame. Text needs an atlas
+// (setAtlas()), e.g. one printed on a device with `disp atlas`.
+template <int16_t Width, int16_t Height>
+class FramebufferPanel : public BeeprPanel<FramebufferPanel<Width, Height> >
+{
+public:
+    static const int16_t WIDTH = Width;
+    static const int16_t HEIGHT = Height;
+
+    FramebufferPanel() : transfers(0), rowTransfers(0), dark(false)
+    {
+        memset(buffer, 0, sizeof(buffer));
+    }
+
+    void panelBegin()
+    {
+    }
+
+    uint8_t *panelFrame()
+    {
+        return buffer;
+    }
+
+    void panelTransfer()
+    {
+        transfers++;
+    }
+
+    void panelTransferRows(uint8_t tileRow, uint8_t tileRows)
+    {
+        (void)tileRow;
+        (void)tileRows;
+        rowTransfers++;
+    }
+
+    void panelPowerSave(bool enable)
+    {
+        dark = enable;
+    }
+
+    int16_t panelMeasure(const char *text)
+    {
+        const GlyphAtlas *glyphs = this->atlas();
+        return glyphs ? BeeprGlyphAtlas::textWidth(*glyphs, text) : 0;
+    }
+
+    void panelDrawText(int16_t x, int16_t baseline, const char *text)
+    {
+        (void)x;
+        (void)baseline;
+        (void)text;
+    }
+
+    bool pixel(int16_t x, int16_t y) const
+    {
+        return (buffer[(y >> 3) * Width + x] >> (y & 7)) & 1;
+    }
+
+    // Binary PBM (P4): rows top to bottom, MSB first, 1 = black. Ink is
+    // written black so frames read like the panel on paper.
+    bool writePbm(FILE *file) const
+    {
+        if (fprintf(file, "P4\n%d %d\n", (int)Width, (int)Height) < 0)
+        {
+            return false;
+        }
+        for (int16_t y = 0; y < Height; y++)
+        {
+            uint8_t row[(Width + 7) / 8] = {0};
+            for (int16_t x = 0; x < Width; x++)
+            {
+                if (pixel(x, y))
+                {
+                    row[x >> 3] |= (uint8_t)(0x80 >> (x & 7));
+                }
+            }
+            if (fwrite(row, 1, sizeof(row), file) != sizeof(row))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 1-bit grayscale PNG, ink black as in writePbm(). The image data is
+    // zlib with stored (uncompressed) blocks, so no zlib is needed and the
+    // same frame always gives the same bytes.
+    bool writePng(FILE *file) const
+    {
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        uint8_t header[13] = {0};
+        putBe32(header, (uint32_t)Width);
+        putBe32(header + 4, (uint32_t)Height);
+        header[8] = 1; // Bit depth
+        header[9] = 0; // Grayscale
+
+        // Each row is a filter byte (0, none) and the packed pixels, 1 = white.
+        static const size_t ROW_BYTES = 1 + (Width + 7) / 8;
+        static const size_t RAW_BYTES = ROW_BYTES * Height;
+        static const size_t BLOCK_MAX = 65535;
+        static const size_t BLOCKS = (RAW_BYTES + BLOCK_MAX - 1) / BLOCK_MAX;
+        uint8_t raw[RAW_BYTES];
+        memset(raw, 0, sizeof(raw));
+        for (int16_t y = 0; y < Height; y++)
+        {
+            uint8_t *row = raw + y * ROW_BYTES + 1;
+            for (int16_t x = 0; x < Width; x++)
+            {
+                if (!pixel(x, y))
+                {
+                    row[x >> 3] |= (uint8_t)(0x80 >> (x & 7));
+                }
+            }
+        }
+
+        uint8_t data[2 + BLOCKS * 5 + RAW_BYTES + 4];
+        size_t len = 0;
+        data[len++] = 0x78; // Deflate, 32K window
+        data[len++] = 0x01; // No dictionary, header check
+        for (size_t done = 0; done < RAW_BYTES;)
+        {
+            size_t n = RAW_BYTES - done < BLOCK_MAX ? RAW_BYTES - done : BLOCK_MAX;
+            data[len++] = done + n == RAW_BYTES ? 1 : 0; // Final block flag, stored
+            data[len++] = (uint8_t)n;
+            data[len++] = (uint8_t)(n >> 8);
+            data[len++] = (uint8_t)~n;
+            data[len++] = (uint8_t)(~n >> 8);
+            memcpy(data + len, raw + done, n);
+            len += n;
+            done += n;
+        }
+        putBe32(data + len, adler32(raw, RAW_BYTES));
+        len += 4;
+
+        return fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+               writePngChunk(file, "IHDR", header, sizeof(header)) && writePngChunk(file, "IDAT", data, len) &&
+               writePngChunk(file, "IEND", nullptr, 0);
+    }
+
+    uint32_t transfers;
+    uint32_t rowTransfers;
+    bool dark;
+
+private:
+    static void putBe32(uint8_t *out, uint32_t value)
+    {
+        out[0] = (uint8_t)(value >> 24);
+        out[1] = (uint8_t)(value >> 16);
+        out[2] = (uint8_t)(value >> 8);
+        out[3] = (uint8_t)value;
+    }
+
+    // Bitwise CRC-32 (PNG/zlib polynomial); frames are small, no table.
+    static uint32_t crc32(uint32_t crc, const uint8_t *bytes, size_t len)
+    {
+        crc = ~crc;
+        for (size_t i = 0; i < len; i++)
+        {
+            crc ^= bytes[i];
+            for (uint8_t bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    static uint32_t adler32(const uint8_t *bytes, size_t len)
+    {
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (size_t i = 0; i < len; i++)
+        {
+            a = (a + bytes[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static bool writePngChunk(FILE *file, const char *type, const uint8_t *data, size_t len)
+    {
+        uint8_t head[8];
+        putBe32(head, (uint32_t)len);
+        memcpy(head + 4, type, 4);
+        uint8_t tail[4];
+        putBe32(tail, crc32(crc32(0, head + 4, 4), data, len));
+        return fwrite(head, 1, sizeof(head), file) == sizeof(head) &&
+               (len == 0 || fwrite(data, 1, len, file) == len) && fwrite(tail, 1, sizeof(tail), file) == sizeof(tail);
+    }
+
+    uint8_t buffer[Width * Height / 8];
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef BEEPR_PANEL_U8G2_H
+#define BEEPR_PANEL_U8G2_H
+
+#include <U8g2lib.h>
+#include "beepr_panel.h"
+
+// u8g2 full-buffer panels over hardware I2C. Text is drawn from the glyph
+// atlas decoded by decodeGlyphs(); u8g2 itself only transfers frames (and
+// draws text if the font does not fit the atlas).
+template <class U8g2Type, int16_t Width, int16_t Height>
+class U8g2Panel : public BeeprPanel<U8g2Panel<U8g2Type, Width, Height> >
+{
+public:
+    static const int16_t WIDTH = Width;
+    static const int16_t HEIGHT = Height;
+
+    U8g2Panel() : oled(U8G2_R0, U8X8_PIN_NONE)
+    {
+    }
+
+    void panelBegin()
+    {
+        oled.begin();
+        oled.setFont(u8g2_font_6x12_tr);
+    }
+
+    uint8_t *panelFrame()
+    {
+        return oled.getBufferPtr();
+    }
+
+    void panelTransfer()
+    {
+        oled.sendBuffer();
+    }
+
+    void panelTransferRows(uint8_t tileRow, uint8_t tileRows)
+    {
+        oled.updateDisplayArea(0, tileRow, Width / 8, tileRows);
+    }
+
+    void panelPowerSave(bool enable)
+    {
+        oled.setPowerSave(enable ? 1 : 0);
+    }
+
+    // Glyph headers only, no bitmap decoding; keeps u8g2's exact right edge.
+    int16_t panelMeasure(const char *text)
+    {
+        return (int16_t)oled.getStrWidth(text);
+    }
+
+    void panelDrawText(int16_t x, int16_t baseline, const char *text)
+    {
+        oled.drawStr(x, baseline, text);
+    }
+
+    // Runs u8g2's decoder once per glyph; false if the font does not fit.
+    bool decodeGlyphs(GlyphAtlas &atlas)
+    {
+        if (oled.getMaxCharWidth() > GLYPH_ATLAS_WIDTH || oled.getMaxCharHeight() > GLYPH_ATLAS_ASCENT)
+        {
+            return false;
+        }
+        const uint8_t *buffer = oled.getBufferPtr();
+        for (uint8_t i = 0; i < GLYPH_ATLAS_COUNT; i++)
+        {
+            char c = (char)(GLYPH_ATLAS_FIRST + i);
+            oled.clearBuffer();
+            oled.drawGlyph(0, GLYPH_ATLAS_ASCENT, (uint16_t)(uint8_t)c);
+            for (int16_t x = 0; x < GLYPH_ATLAS_WIDTH; x++)
+            {
+                // The atlas keeps 4 rows below the baseline (pages 0-1).
+                if (buffer[2 * Width + x] != 0)
+                {
+                    oled.clearBuffer();
+                    return false;
+                }
+            }
+            BeeprGlyphAtlas::capture(atlas, c, buffer, Width, 0);
+        }
+        oled.clearBuffer();
+        return true;
+    }
+
+private:
+    U8g2Type oled;
+};
+
+typedef U8g2Panel<U8G2_SH1106_128X64_NONAME_F_HW_I2C, 128, 64> Sh1106Panel;
+typedef U8g2Panel<U8G2_SSD1306_128X64_NONAME_F_HW_I2C, 128, 64> Ssd1306Panel;
+
+#endif
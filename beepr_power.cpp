@@ -0,0 +1,291 @@
+#include "beepr_power.h"
+#include "beepr_config.h"
+#include "beepr_log.h"
+#include "beepr_display.h"
+#include "beepr_power_state.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#if CONFIG_BTDM_CTRL_MODEM_SLEEP
+#include "esp_bt.h"
+#endif
+
+// Held across the display call so power-save transitions reach the panel in
+// the order the state machine decided them.
+static SemaphoreHandle_t powerMutex = nullptr;
+static PowerState state;
+static bool lightSleepEnabled = false;
+static bool modemSleepEnabled = false;
+static bool keptAwake = false;
+static TaskHandle_t updateTask = nullptr;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t consoleLock = nullptr;
+#endif
+// Console hold, touched by the loop task only.
+static bool consoleHeld = false;
+static uint32_t consoleLastMs = 0;
+static uint32_t consoleHolds = 0;
+
+static void lockPower()
+{
+    if (powerMutex)
+    {
+        xSemaphoreTake(powerMutex, portMAX_DELAY);
+    }
+}
+
+static void unlockPower()
+{
+    if (powerMutex)
+    {
+        xSemaphoreGive(powerMutex);
+    }
+}
+
+static void applyLocked(PowerAction action)
+{
+    if (action == PowerActionDisplayOff)
+    {
+        BeeprDisplay::setPowerSave(true);
+    }
+    else if (action == PowerActionDisplayOn)
+    {
+        BeeprDisplay::setPowerSave(false);
+        // The task may be sleeping with no idle deadline at all.
+        if (updateTask)
+        {
+            xTaskNotifyGive(updateTask);
+        }
+    }
+}
+
+static void setConsoleHold(bool hold)
+{
+    consoleHeld = hold;
+#if CONFIG_PM_ENABLE
+    if (consoleLock)
+    {
+        if (hold)
+        {
+            esp_pm_lock_acquire(consoleLock);
+        }
+        else
+        {
+            esp_pm_lock_release(consoleLock);
+        }
+    }
+#endif
+}
+
+static bool enableLightSleep()
+{
+#if CONFIG_PM_ENABLE
+    // Frequency scaling stays off (min == max) so UART and I2C timing never
+    // change under us; only the idle task is allowed to light-sleep.
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    esp_pm_config_t config = {};
+#else
+    esp_pm_config_esp32_t config = {};
+#endif
+    config.max_freq_mhz = (int)getCpuFrequencyMhz();
+    config.min_freq_mhz = (int)getCpuFrequencyMhz();
+    config.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK)
+    {
+        // ESP_ERR_NOT_SUPPORTED means the core was built without tickless idle.
+        BEEPR_LOGW("Power: light sleep unavailable (%s)\n", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+#else
+    BEEPR_LOGW("Power: light sleep unavailable (CONFIG_PM_ENABLE off)\n");
+    return false;
+#endif
+}
+
+static bool enableModemSleep()
+{
+#if CONFIG_BTDM_CTRL_MODEM_SLEEP
+    return esp_bt_sleep_enable() == ESP_OK;
+#else
+    return false;
+#endif
+}
+
+void BeeprPower::begin()
+{
+    powerMutex = xSemaphoreCreateMutex();
+    BeeprPowerState::reset(state, POWER_DISPLAY_TIMEOUT_MS, millis());
+
+#if BEEPR_HAS_BUTTONS
+    // The buttons are level-triggered, so the same lines wake the CPU.
+    gpio_wakeup_enable((gpio_num_t)BTN_NEXT_PIN, GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable((gpio_num_t)BTN_CLEAR_PIN, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+#endif
+#if BEEPR_HAS_CONSOLE
+    // UART RX only wakes the CPU by counting edges and the characters that
+    // did it are lost; noteConsole() then keeps it awake for the session.
+    uart_set_wakeup_threshold(UART_NUM_0, 3);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "beepr_console", &consoleLock);
+#endif
+#endif
+
+    modemSleepEnabled = enableModemSleep();
+    if (POWER_LIGHT_SLEEP)
+    {
+        // Without a 32 kHz crystal the BLE controller holds a PM lock while
+        // connected, and idle falls back to plain WFI.
+        lightSleepEnabled = enableLightSleep();
+    }
+    BEEPR_LOGI("Power: light sleep %s, modem sleep %s, display timeout %lums\n",
+               lightSleepEnabled ? "on" : "off", modemSleepEnabled ? "on" : "off",
+               (unsigned long)POWER_DISPLAY_TIMEOUT_MS);
+}
+
+bool BeeprPower::noteButton()
+{
+    lockPower();
+    PowerAction action = BeeprPowerState::onActivity(state, PowerWakeButton, millis());
+    applyLocked(action);
+    unlockPower();
+    return action == PowerActionDisplayOn;
+}
+
+void BeeprPower::noteNotification()
+{
+    lockPower();
+    applyLocked(BeeprPowerState::onActivity(state, PowerWakeNotification, millis()));
+    unlockPower();
+}
+
+void BeeprPower::attachTask(TaskHandle_t task)
+{
+    updateTask = task;
+}
+
+uint32_t BeeprPower::update()
+{
+    uint32_t now = millis();
+    lockPower();
+    applyLocked(BeeprPowerState::onTick(state, now));
+    // msUntilIdle() is 0 both when due and when nothing is pending.
+    uint32_t waitMs = POWER_NO_DEADLINE;
+    if (state.displayOn && state.timeoutMs)
+    {
+        waitMs = BeeprPowerState::msUntilIdle(state, now);
+    }
+    unlockPower();
+
+    if (consoleHeld)
+    {
+        uint32_t quietMs = now - consoleLastMs;
+        if (quietMs >= POWER_CONSOLE_HOLD_MS)
+        {
+            setConsoleHold(false);
+        }
+        else if (POWER_CONSOLE_HOLD_MS - quietMs < waitMs)
+        {
+            waitMs = POWER_CONSOLE_HOLD_MS - quietMs;
+        }
+    }
+    return waitMs;
+}
+
+void BeeprPower::noteConsole()
+{
+    consoleLastMs = millis();
+    if (!consoleHeld && !keptAwake)
+    {
+        consoleHolds++;
+        setConsoleHold(true);
+    }
+}
+
+void BeeprPower::keepAwake()
+{
+    if (keptAwake)
+    {
+        return;
+    }
+    keptAwake = true;
+    if (consoleHeld)
+    {
+        setConsoleHold(false);
+    }
+#if CONFIG_PM_ENABLE
+    // UART RX wakes the CPU (see begin()), but the bytes that do it are lost,
+    // which a framed binary session cannot afford.
+    static esp_pm_lock_handle_t awakeLock = nullptr;
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "beepr_awake", &awakeLock) == ESP_OK)
+    {
+        esp_pm_lock_acquire(awakeLock);
+    }
+#endif
+}
+
+static const char *wakeCauseName(esp_sleep_source_t cause)
+{
+    switch (cause)
+    {
+    case ESP_SLEEP_WAKEUP_UNDEFINED:
+        return "none yet";
+    case ESP_SLEEP_WAKEUP_TIMER:
+        return "timer";
+    case ESP_SLEEP_WAKEUP_GPIO:
+        return "button";
+    case ESP_SLEEP_WAKEUP_UART:
+        return "console";
+    default:
+        return "other";
+    }
+}
+
+void BeeprPower::printStats()
+{
+    lockPower();
+    uint32_t now = millis();
+    PowerState s = state;
+    uint32_t idleInMs = BeeprPowerState::msUntilIdle(state, now);
+    unlockPower();
+
+    uint32_t onMs = 0;
+    uint32_t offMs = 0;
+    BeeprPowerState::residency(s, now, onMs, offMs);
+    uint32_t totalMs = onMs + offMs;
+    Serial.printf("Power: light sleep %s%s, modem sleep %s, console holds=%lu\n",
+                  lightSleepEnabled ? "on" : "off",
+                  keptAwake ? " (held off)" : consoleHeld ? " (held by console)" : "",
+                  modemSleepEnabled ? "on" : "off", (unsigned long)consoleHolds);
+    Serial.printf("Display: %s, on %lus off %lus (%lu%% off), sleeps=%lu, idle in %lums\n",
+                  s.displayOn ? "on" : "power-save",
+                  (unsigned long)(onMs / 1000), (unsigned long)(offMs / 1000),
+                  totalMs ? (unsigned long)((uint64_t)offMs * 100 / totalMs) : 0UL,
+                  (unsigned long)s.displaySleeps, (unsigned long)idleInMs);
+    Serial.printf("Display wakes: button=%lu/%lu notification=%lu/%lu (woke/total)\n",
+                  (unsigned long)s.wakes[PowerWakeButton], (unsigned long)s.activity[PowerWakeButton],
+                  (unsigned long)s.wakes[PowerWakeNotification], (unsigned long)s.activity[PowerWakeNotification]);
+    // The IDF keeps only the cause of the latest light-sleep wake; counts per
+    // cause and CPU sleep residency need a core built with CONFIG_PM_PROFILING.
+    if (lightSleepEnabled)
+    {
+        Serial.printf("CPU: last light-sleep wake by %s\n", wakeCauseName(esp_sleep_get_wakeup_cause()));
+    }
+#if CONFIG_PM_ENABLE && CONFIG_PM_PROFILING
+    // Per-mode residency (including light sleep) is only tracked by the PM
+    // implementation when the core is built with profiling.
+    esp_pm_dump_locks(stdout);
+#endif
+}
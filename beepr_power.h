@@ -0,0 +1,31 @@
+#ifndef BEEPR_POWER_H
+#define BEEPR_POWER_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Idle power manager: automatic light sleep with BLE modem sleep between
+// connection events, button GPIO wakeups, and display power-save after
+// POWER_DISPLAY_TIMEOUT_MS without activity.
+namespace BeeprPower
+{
+    // Call after BeeprButtons::begin() and BeeprBle::begin().
+    void begin();
+    // Task that calls update(); woken when the display comes back on, since
+    // that starts a new idle deadline.
+    void attachTask(TaskHandle_t task);
+    // Returns true if the press only woke the display and should be dropped.
+    bool noteButton();
+    void noteNotification();
+    // Returns how long the task may sleep before the next call, unless woken.
+    uint32_t update();
+    // Text console input: holds light sleep off until POWER_CONSOLE_HOLD_MS
+    // after the last call. Loop task only.
+    void noteConsole();
+    // Blocks light sleep from now on, for a host streaming over the UART.
+    void keepAwake();
+    void printStats();
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "beepr_power_state.h"
+
+static void enterState(PowerState &state, bool displayOn, uint32_t nowMs)
+{
+    uint32_t spent = nowMs - state.stateSinceMs;
+    if (state.displayOn)
+    {
+        state.displayOnMs += spent;
+    }
+    else
+    {
+        state.displayOffMs += spent;
+    }
+    state.displayOn = displayOn;
+    state.stateSinceMs = nowMs;
+}
+
+void BeeprPowerState::reset(PowerState &state, uint32_t timeoutMs, uint32_t nowMs)
+{
+    state = PowerState();
+    state.timeoutMs = timeoutMs;
+    state.lastActivityMs = nowMs;
+    state.stateSinceMs = nowMs;
+    state.displayOn = true;
+}
+
+PowerAction BeeprPowerState::onActivity(PowerState &state, PowerWakeSource source, uint32_t nowMs)
+{
+    if (source >= PowerWakeSourceCount)
+    {
+        return PowerActionNone;
+    }
+    state.activity[source]++;
+    state.lastActivityMs = nowMs;
+    if (state.displayOn)
+    {
+        return PowerActionNone;
+    }
+    state.wakes[source]++;
+    enterState(state, true, nowMs);
+    return PowerActionDisplayOn;
+}
+
+PowerAction BeeprPowerState::onTick(PowerState &state, uint32_t nowMs)
+{
+    if (!state.displayOn || state.timeoutMs == 0 || (nowMs - state.lastActivityMs) < state.timeoutMs)
+    {
+        return PowerActionNone;
+    }
+    state.displaySleeps++;
+    enterState(state, false, nowMs);
+    return PowerActionDisplayOff;
+}
+
+uint32_t BeeprPowerState::msUntilIdle(const PowerState &state, uint32_t nowMs)
+{
+    if (!state.displayOn || state.timeoutMs == 0)
+    {
+        return 0;
+    }
+    uint32_t idleMs = nowMs - state.lastActivityMs;
+    return idleMs < state.timeoutMs ? state.timeoutMs - idleMs : 0;
+}
+
+void BeeprPowerState::residency(const PowerState &state, uint32_t nowMs, uint32_t &onMs, uint32_t &offMs)
+{
+    uint32_t spent = nowMs - state.stateSinceMs;
+    onMs = state.displayOnMs + (state.displayOn ? spent : 0);
+    offMs = state.displayOffMs + (state.displayOn ? 0 : spent);
+}
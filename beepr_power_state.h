@@ -0,0 +1,47 @@
+#ifndef BEEPR_POWER_STATE_H
+#define BEEPR_POWER_STATE_H
+
+#include <stdint.h>
+
+// Display power state machine. Pure logic on caller-supplied timestamps with
+// no Arduino or IDF dependencies, so it builds and runs unchanged on a host.
+
+enum PowerWakeSource : uint8_t
+{
+    PowerWakeButton = 0,
+    PowerWakeNotification = 1,
+    PowerWakeSourceCount = 2
+};
+
+enum PowerAction : uint8_t
+{
+    PowerActionNone = 0,
+    PowerActionDisplayOff = 1,
+    PowerActionDisplayOn = 2
+};
+
+struct PowerState
+{
+    uint32_t timeoutMs;       // 0 keeps the display on.
+    uint32_t lastActivityMs;
+    uint32_t stateSinceMs;
+    bool displayOn;
+
+    // Residency excludes the time spent in the current state.
+    uint32_t displayOnMs;
+    uint32_t displayOffMs;
+    uint32_t displaySleeps;
+    uint32_t activity[PowerWakeSourceCount];
+    uint32_t wakes[PowerWakeSourceCount];   // Activity that turned the display on.
+};
+
+namespace BeeprPowerState
+{
+    void reset(PowerState &state, uint32_t timeoutMs, uint32_t nowMs);
+    PowerAction onActivity(PowerState &state, PowerWakeSource source, uint32_t nowMs);
+    PowerAction onTick(PowerState &state, uint32_t nowMs);
+    uint32_t msUntilIdle(const PowerState &state, uint32_t nowMs);
+    void residency(const PowerState &state, uint32_t nowMs, uint32_t &onMs, uint32_t &offMs);
+}
+
+#endif
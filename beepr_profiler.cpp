@@ -0,0 +1,200 @@
+#include "beepr_profiler.h"
+#include "beepr_config.h"
+#include "beepr_events.h"
+#include "beepr_log.h"
+
+#include "esp_heap_caps.h"
+
+struct WatchedTask
+{
+    TaskHandle_t handle;
+    uint32_t stackSize;
+    uint32_t minFreeStack;
+};
+
+struct HeapSample
+{
+    uint32_t freeBytes;
+    uint32_t largestBlock;
+    uint32_t minEverFree;
+};
+
+static const uint8_t MAX_WATCHED_TASKS = 6;
+static const uint8_t MAX_SYSTEM_TASKS = 24;
+
+static WatchedTask watchedTasks[MAX_WATCHED_TASKS];
+static uint8_t watchedTaskCount = 0;
+static uint32_t lastSampleMs = 0;
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+static TaskStatus_t systemTasks[MAX_SYSTEM_TASKS];
+static uint32_t lastRunTime[MAX_SYSTEM_TASKS];
+static TaskHandle_t lastRunHandle[MAX_SYSTEM_TASKS];
+static uint32_t lastTotalRunTime = 0;
+#endif
+
+static HeapSample sampleHeap()
+{
+    HeapSample s;
+    s.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    s.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    s.minEverFree = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    return s;
+}
+
+static uint8_t fragmentationPercent(const HeapSample &s)
+{
+    if (s.freeBytes == 0)
+    {
+        return 0;
+    }
+    return (uint8_t)(100 - (uint64_t)s.largestBlock * 100 / s.freeBytes);
+}
+
+static uint32_t sampleStacks()
+{
+    uint32_t warnings = 0;
+    for (uint8_t i = 0; i < watchedTaskCount; ++i)
+    {
+        WatchedTask &t = watchedTasks[i];
+        // ESP-IDF reports the high-water mark in bytes.
+        uint32_t freeStack = uxTaskGetStackHighWaterMark(t.handle);
+        if (freeStack < t.minFreeStack)
+        {
+            t.minFreeStack = freeStack;
+        }
+        if (freeStack < PROFILER_STACK_WARN_BYTES)
+        {
+            BEEPR_LOGW("PROF WARN: %s stack headroom %lu/%lu bytes\n", pcTaskGetName(t.handle),
+                       (unsigned long)freeStack, (unsigned long)t.stackSize);
+            warnings++;
+        }
+    }
+    return warnings;
+}
+
+static uint32_t checkHeap(const HeapSample &heap)
+{
+    uint32_t warnings = 0;
+    if (heap.minEverFree < PROFILER_HEAP_WARN_BYTES)
+    {
+        BEEPR_LOGW("PROF WARN: heap low-water %lu bytes\n", (unsigned long)heap.minEverFree);
+        warnings++;
+    }
+    if (fragmentationPercent(heap) > PROFILER_FRAG_WARN_PERCENT)
+    {
+        BEEPR_LOGW("PROF WARN: heap fragmented, largest block %lu of %lu free\n",
+                   (unsigned long)heap.largestBlock, (unsigned long)heap.freeBytes);
+        warnings++;
+    }
+    return warnings;
+}
+
+static uint32_t checkLanes()
+{
+    uint32_t warnings = 0;
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        if (BeeprEvents::laneHighWater((EventLane)lane) >= BeeprEvents::laneDepth((EventLane)lane))
+        {
+            BEEPR_LOGW("PROF WARN: event lane %u saturated (depth %u)\n", (unsigned)lane,
+                       (unsigned)BeeprEvents::laneDepth((EventLane)lane));
+            warnings++;
+        }
+    }
+    return warnings;
+}
+
+static void printCpuShare()
+{
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    uint32_t totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(systemTasks, MAX_SYSTEM_TASKS, &totalRunTime);
+    uint32_t totalDelta = totalRunTime - lastTotalRunTime;
+    lastTotalRunTime = totalRunTime;
+
+    Serial.println("  CPU share since last report:");
+    for (UBaseType_t i = 0; i < count; ++i)
+    {
+        const TaskStatus_t &t = systemTasks[i];
+        uint32_t previous = 0;
+        for (UBaseType_t j = 0; j < MAX_SYSTEM_TASKS; ++j)
+        {
+            if (lastRunHandle[j] == t.xHandle)
+            {
+                previous = lastRunTime[j];
+                break;
+            }
+        }
+        uint32_t delta = t.ulRunTimeCounter - previous;
+        uint32_t permille = totalDelta ? (uint32_t)((uint64_t)delta * 1000 / totalDelta) : 0;
+        Serial.printf("    %-16s %3lu.%lu%%\n", t.pcTaskName, (unsigned long)(permille / 10),
+                      (unsigned long)(permille % 10));
+    }
+    for (UBaseType_t i = 0; i < MAX_SYSTEM_TASKS; ++i)
+    {
+        lastRunHandle[i] = i < count ? systemTasks[i].xHandle : nullptr;
+        lastRunTime[i] = i < count ? systemTasks[i].ulRunTimeCounter : 0;
+    }
+#else
+    Serial.println("  CPU share: unavailable (FreeRTOS run time stats disabled)");
+#endif
+}
+
+void BeeprProfiler::watchTask(TaskHandle_t handle, uint32_t stackSize)
+{
+    if (!handle || watchedTaskCount >= MAX_WATCHED_TASKS)
+    {
+        return;
+    }
+    watchedTasks[watchedTaskCount++] = {handle, stackSize, stackSize};
+}
+
+uint32_t BeeprProfiler::update()
+{
+    uint32_t now = millis();
+    if (now - lastSampleMs < PROFILER_SAMPLE_MS)
+    {
+        return PROFILER_SAMPLE_MS - (now - lastSampleMs);
+    }
+    lastSampleMs = now;
+
+    // Only complain periodically; the full report is on demand.
+    sampleStacks();
+    checkHeap(sampleHeap());
+    checkLanes();
+    return PROFILER_SAMPLE_MS;
+}
+
+void BeeprProfiler::print()
+{
+    uint32_t warnings = sampleStacks();
+
+    Serial.printf("Profiler (uptime %lus):\n", (unsigned long)(millis() / 1000));
+    Serial.println("  Stacks (free now / min free / size):");
+    for (uint8_t i = 0; i < watchedTaskCount; ++i)
+    {
+        const WatchedTask &t = watchedTasks[i];
+        Serial.printf("    %-16s %5lu / %5lu / %5lu\n", pcTaskGetName(t.handle),
+                      (unsigned long)uxTaskGetStackHighWaterMark(t.handle),
+                      (unsigned long)t.minFreeStack, (unsigned long)t.stackSize);
+    }
+
+    HeapSample heap = sampleHeap();
+    Serial.printf("  Heap: free=%lu largest=%lu min=%lu frag=%u%%\n",
+                  (unsigned long)heap.freeBytes, (unsigned long)heap.largestBlock,
+                  (unsigned long)heap.minEverFree, (unsigned)fragmentationPercent(heap));
+    warnings += checkHeap(heap);
+
+    Serial.println("  Event lanes (high-water / depth):");
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        Serial.printf("    lane %u: %lu / %u\n", (unsigned)lane,
+                      (unsigned long)BeeprEvents::laneHighWater((EventLane)lane),
+                      (unsigned)BeeprEvents::laneDepth((EventLane)lane));
+    }
+    warnings += checkLanes();
+
+    printCpuShare();
+    Serial.printf("  Warnings: %lu\n", (unsigned long)warnings);
+}
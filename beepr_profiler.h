@@ -0,0 +1,16 @@
+#ifndef BEEPR_PROFILER_H
+#define BEEPR_PROFILER_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace BeeprProfiler
+{
+    void watchTask(TaskHandle_t handle, uint32_t stackSize);
+    // Returns the time until the next periodic sample.
+    uint32_t update();
+    void print();
+}
+
+#endif
@@ -0,0 +1,489 @@
+#include "beepr_proto.h"
+#include "beepr_config.h"
+#include "beepr_events.h"
+#include "beepr_notifs.h"
+
+#include "esp_heap_caps.h"
+
+static const uint8_t PROTO_VERSION = 1;
+// type + seq + crc around the payload.
+static const size_t FRAME_OVERHEAD = 4;
+// COBS adds one byte per 254, plus the leading code byte and two delimiters.
+static const size_t ENCODED_MAX = PROTO_MAX_FRAME + PROTO_MAX_FRAME / 254 + 3;
+static const uint8_t INJECT_OP_ADD = 0;
+static const uint8_t INJECT_OP_REMOVE = 1;
+static const uint8_t BURST_MIXED = 0xFF;
+
+struct ProtoStats
+{
+    uint32_t rxFrames;
+    uint32_t rxCrcErrors;
+    uint32_t rxFramingErrors;
+    uint32_t injected;
+    uint32_t injectRejected;
+};
+
+// Only the console (loop task) drives the protocol, so plain statics suffice.
+static uint8_t rxBuf[ENCODED_MAX];
+static size_t rxLen = 0;
+static bool rxOverflow = false;
+static uint8_t txFrame[PROTO_MAX_FRAME];
+static uint8_t txEncoded[ENCODED_MAX];
+static ProtoStats protoStats = {};
+
+struct FrameWriter
+{
+    uint8_t *buf;
+    size_t len;
+    bool overflow;
+
+    void put8(uint8_t v)
+    {
+        // Two bytes stay reserved for the CRC.
+        if (len + 2 >= PROTO_MAX_FRAME)
+        {
+            overflow = true;
+            return;
+        }
+        buf[len++] = v;
+    }
+    void put16(uint16_t v)
+    {
+        put8((uint8_t)v);
+        put8((uint8_t)(v >> 8));
+    }
+    void put32(uint32_t v)
+    {
+        put16((uint16_t)v);
+        put16((uint16_t)(v >> 16));
+    }
+    void putStr(const char *s)
+    {
+        size_t n = strlen(s);
+        if (n > 255)
+        {
+            n = 255;
+        }
+        put8((uint8_t)n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            put8((uint8_t)s[i]);
+        }
+    }
+};
+
+struct FrameReader
+{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool ok;
+
+    bool atEnd() const
+    {
+        return pos >= len;
+    }
+    uint8_t get8()
+    {
+        if (pos >= len)
+        {
+            ok = false;
+            return 0;
+        }
+        return buf[pos++];
+    }
+    uint16_t get16()
+    {
+        uint16_t lo = get8();
+        return (uint16_t)(lo | (get8() << 8));
+    }
+    uint32_t get32()
+    {
+        uint32_t lo = get16();
+        return lo | ((uint32_t)get16() << 16);
+    }
+    // Copies a length-prefixed string, truncating to dstSize - 1.
+    void getStr(char *dst, size_t dstSize)
+    {
+        uint8_t n = get8();
+        if (!ok || pos + n > len)
+        {
+            ok = false;
+            dst[0] = '\0';
+            return;
+        }
+        size_t copy = n < dstSize - 1 ? n : dstSize - 1;
+        memcpy(dst, buf + pos, copy);
+        dst[copy] = '\0';
+        pos += n;
+    }
+};
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    // CRC-16/CCITT-FALSE. Bitwise is plenty at UART rates.
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; ++b)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// In-place COBS decode. Returns the decoded length, or 0 on a bad encoding.
+static size_t cobsDecode(uint8_t *buf, size_t len)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < len)
+    {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > len)
+        {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; ++i)
+        {
+            buf[out++] = buf[in++];
+        }
+        if (code < 0xFF && in < len)
+        {
+            buf[out++] = 0;
+        }
+    }
+    return out;
+}
+
+static size_t cobsEncode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t out = 1;
+    size_t codePos = 0;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (src[i] == 0)
+        {
+            dst[codePos] = code;
+            codePos = out++;
+            code = 1;
+            continue;
+        }
+        dst[out++] = src[i];
+        if (++code == 0xFF)
+        {
+            dst[codePos] = code;
+            codePos = out++;
+            code = 1;
+        }
+    }
+    dst[codePos] = code;
+    return out;
+}
+
+static FrameWriter beginReply(uint8_t type, uint8_t seq)
+{
+    FrameWriter w = {txFrame, 0, false};
+    w.put8(type);
+    w.put8(seq);
+    return w;
+}
+
+static void sendReply(FrameWriter &w)
+{
+    if (w.overflow)
+    {
+        return;
+    }
+    uint16_t crc = crc16(w.buf, w.len);
+    w.buf[w.len++] = (uint8_t)crc;
+    w.buf[w.len++] = (uint8_t)(crc >> 8);
+
+    txEncoded[0] = 0;
+    size_t n = 1 + cobsEncode(w.buf, w.len, txEncoded + 1);
+    txEncoded[n++] = 0;
+    // One write call, so log lines from other tasks cannot land mid-frame.
+    Serial.write(txEncoded, n);
+}
+
+static void sendError(uint8_t seq, ProtoError code)
+{
+    FrameWriter w = beginReply(ProtoMsgError, seq);
+    w.put8(code);
+    sendReply(w);
+}
+
+static bool injectAdd(uint32_t uid, uint8_t category, FrameReader *r, uint16_t burstIndex)
+{
+    PendingNotifEvent event = {};
+    event.type = PendingEventAdd;
+    event.uid = uid;
+    event.category = (NotificationCategory)category;
+    event.categoryCount = 1;
+    event.record = BeeprNotifs::claimRecord();
+    NotifRecord *rec = BeeprNotifs::record(event.record);
+    if (!rec)
+    {
+        return false;
+    }
+    if (r)
+    {
+        r->getStr(rec->app, sizeof(rec->app));
+        r->getStr(rec->title, sizeof(rec->title));
+        r->getStr(rec->message, sizeof(rec->message));
+        if (!r->ok)
+        {
+            BeeprNotifs::releaseRecord(event.record);
+            return false;
+        }
+    }
+    else
+    {
+        snprintf(rec->app, sizeof(rec->app), "Burst");
+        snprintf(rec->title, sizeof(rec->title), "Burst %u", (unsigned)burstIndex);
+        snprintf(rec->message, sizeof(rec->message), "Lane %u", (unsigned)BeeprEvents::laneFor(event.category));
+    }
+    return BeeprEvents::enqueue(event);
+}
+
+static bool injectRemove(uint32_t uid, uint8_t category)
+{
+    PendingNotifEvent event = {};
+    event.type = PendingEventRemove;
+    event.uid = uid;
+    event.category = (NotificationCategory)category;
+    event.record = NOTIF_NO_RECORD;
+    return BeeprEvents::enqueue(event);
+}
+
+static void sendInjectAck(uint8_t seq, uint16_t accepted, uint16_t rejected)
+{
+    protoStats.injected += accepted;
+    protoStats.injectRejected += rejected;
+    FrameWriter w = beginReply(ProtoMsgInjectAck, seq);
+    w.put16(accepted);
+    w.put16(rejected);
+    sendReply(w);
+}
+
+static void handleInject(uint8_t seq, FrameReader &r)
+{
+    uint16_t accepted = 0;
+    uint16_t rejected = 0;
+    while (r.ok && !r.atEnd())
+    {
+        uint8_t op = r.get8();
+        uint32_t uid = r.get32();
+        uint8_t category = r.get8();
+        if (!r.ok || category >= NOTIF_CATEGORY_COUNT || op > INJECT_OP_REMOVE)
+        {
+            // The rest of the frame cannot be parsed reliably.
+            rejected++;
+            break;
+        }
+        bool queued = op == INJECT_OP_ADD ? injectAdd(uid, category, &r, 0) : injectRemove(uid, category);
+        if (!r.ok)
+        {
+            rejected++;
+            break;
+        }
+        if (queued)
+        {
+            accepted++;
+        }
+        else
+        {
+            rejected++;
+        }
+    }
+    sendInjectAck(seq, accepted, rejected);
+}
+
+static void handleBurst(uint8_t seq, FrameReader &r)
+{
+    uint16_t count = r.get16();
+    uint32_t baseUid = r.get32();
+    uint8_t category = r.get8();
+    if (!r.ok || (category >= NOTIF_CATEGORY_COUNT && category != BURST_MIXED))
+    {
+        sendError(seq, ProtoErrorMalformed);
+        return;
+    }
+
+    uint16_t accepted = 0;
+    uint16_t rejected = 0;
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        uint8_t c = category == BURST_MIXED ? (uint8_t)(i % NOTIF_CATEGORY_COUNT) : category;
+        if (injectAdd(baseUid + i, c, nullptr, i))
+        {
+            accepted++;
+        }
+        else
+        {
+            rejected++;
+        }
+    }
+    sendInjectAck(seq, accepted, rejected);
+}
+
+static void handleDump(uint8_t seq)
+{
+    const NotifView *view = BeeprNotifs::acquireView();
+    uint8_t total = view ? (uint8_t)view->total : 0;
+    if (view)
+    {
+        BeeprNotifs::releaseView(view);
+    }
+
+    uint8_t sent = 0;
+    NotifEntry entry;
+    for (uint8_t i = 0; i < total && BeeprNotifs::retainEntry(i, entry); ++i)
+    {
+        const NotifRecord *rec = BeeprNotifs::record(entry.record);
+        FrameWriter w = beginReply(ProtoMsgDumpEntry, seq);
+        w.put8(i);
+        w.put8(total);
+        w.put32(entry.uid);
+        w.put8(entry.category);
+        w.putStr(rec ? rec->app : "");
+        w.putStr(rec ? rec->title : "");
+        w.putStr(rec ? rec->message : "");
+        BeeprNotifs::releaseRecord(entry.record);
+        sendReply(w);
+        sent++;
+    }
+
+    FrameWriter w = beginReply(ProtoMsgDumpEnd, seq);
+    w.put8(sent);
+    sendReply(w);
+}
+
+// uptimeMs:u32 laneCount:u8
+// per lane: enqueued dropped dequeued highWater latencyMaxUs latencyAvgUs (u32)
+// storeCount:u16 duplicateUpdates:u32 heapFree:u32 heapMinFree:u32
+// rxFrames rxCrcErrors rxFramingErrors injected injectRejected (u32)
+// per lane: backlogSpilled backlogHighWater (u32)
+static void sendCounters(uint8_t seq)
+{
+    FrameWriter w = beginReply(ProtoMsgCounters, seq);
+    w.put32(millis());
+    w.put8(EventLaneCount);
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        EventLaneStats s = {};
+        BeeprEvents::laneCounters((EventLane)lane, s);
+        w.put32(s.enqueued);
+        w.put32(s.dropped);
+        w.put32(s.dequeued);
+        w.put32(s.highWater);
+        w.put32(s.latencyMaxUs);
+        w.put32(s.dequeued ? (uint32_t)(s.latencyTotalUs / s.dequeued) : 0);
+    }
+
+    const NotifView *view = BeeprNotifs::acquireView();
+    w.put16(view ? view->total : 0);
+    if (view)
+    {
+        BeeprNotifs::releaseView(view);
+    }
+    w.put32(BeeprNotifs::duplicateUpdates());
+    w.put32((uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    w.put32((uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+
+    w.put32(protoStats.rxFrames);
+    w.put32(protoStats.rxCrcErrors);
+    w.put32(protoStats.rxFramingErrors);
+    w.put32(protoStats.injected);
+    w.put32(protoStats.injectRejected);
+    // Backlog counters come last, so hosts that predate them can ignore them.
+    for (uint8_t lane = 0; lane < EventLaneCount; ++lane)
+    {
+        EventLaneStats s = {};
+        BeeprEvents::laneCounters((EventLane)lane, s);
+        w.put32(s.spilled);
+        w.put32(s.backlogHighWater);
+    }
+    sendReply(w);
+}
+
+static void handleFrame(uint8_t *frame, size_t len)
+{
+    if (len < FRAME_OVERHEAD)
+    {
+        protoStats.rxFramingErrors++;
+        return;
+    }
+    uint16_t crc = (uint16_t)(frame[len - 2] | (frame[len - 1] << 8));
+    if (crc16(frame, len - 2) != crc)
+    {
+        protoStats.rxCrcErrors++;
+        return;
+    }
+    protoStats.rxFrames++;
+
+    uint8_t type = frame[0];
+    uint8_t seq = frame[1];
+    FrameReader r = {frame + 2, len - FRAME_OVERHEAD, 0, true};
+    switch (type)
+    {
+    case ProtoMsgPing:
+    {
+        FrameWriter w = beginReply(ProtoMsgPong, seq);
+        w.put8(PROTO_VERSION);
+        w.put32(millis());
+        sendReply(w);
+        break;
+    }
+    case ProtoMsgInject:
+        handleInject(seq, r);
+        break;
+    case ProtoMsgBurst:
+        handleBurst(seq, r);
+        break;
+    case ProtoMsgDump:
+        handleDump(seq);
+        break;
+    case ProtoMsgReadCounters:
+        sendCounters(seq);
+        break;
+    default:
+        sendError(seq, ProtoErrorUnknownType);
+        break;
+    }
+}
+
+void BeeprProto::feed(uint8_t c)
+{
+    if (c != 0)
+    {
+        if (rxLen < sizeof(rxBuf))
+        {
+            rxBuf[rxLen++] = c;
+        }
+        else
+        {
+            rxOverflow = true;
+        }
+        return;
+    }
+
+    // Back-to-back delimiters are just idle line.
+    if (rxLen > 0)
+    {
+        size_t len = rxOverflow ? 0 : cobsDecode(rxBuf, rxLen);
+        if (len == 0)
+        {
+            protoStats.rxFramingErrors++;
+        }
+        else
+        {
+            handleFrame(rxBuf, len);
+        }
+    }
+    rxLen = 0;
+    rxOverflow = false;
+}
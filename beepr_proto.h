@@ -0,0 +1,46 @@
+#ifndef BEEPR_PROTO_H
+#define BEEPR_PROTO_H
+
+#include <Arduino.h>
+
+// Binary control protocol on the serial console, for scripted load tests
+// (tools/beeprctl.py). Each frame is COBS encoded and delimited by 0x00 on
+// both sides:
+//
+//   type:u8 seq:u8 payload... crc:u16le   (CRC-16/CCITT-FALSE over type..payload)
+//
+// Replies echo the request's seq. Multi-byte fields are little endian and
+// strings are length-prefixed (len:u8 bytes...), without a terminator.
+enum ProtoMsgType : uint8_t
+{
+    ProtoMsgPing = 0x01,         // -> Pong
+    ProtoMsgInject = 0x02,       // items... -> InjectAck
+    ProtoMsgBurst = 0x03,        // count:u16 baseUid:u32 category:u8 (0xFF mixes) -> InjectAck
+    ProtoMsgDump = 0x04,         // -> DumpEntry * n, DumpEnd
+    ProtoMsgReadCounters = 0x05, // -> Counters
+
+    ProtoMsgPong = 0x81,         // version:u8 uptimeMs:u32
+    ProtoMsgInjectAck = 0x82,    // accepted:u16 rejected:u16
+    ProtoMsgDumpEntry = 0x84,    // index:u8 total:u8 uid:u32 category:u8 app title message
+    ProtoMsgDumpEnd = 0x85,      // count:u8
+    ProtoMsgCounters = 0x86,     // see sendCounters() in beepr_proto.cpp
+    ProtoMsgError = 0xFF         // code:u8
+};
+
+// Inject item: op:u8 (0 add, 1 remove) uid:u32 category:u8, then for adds
+// app, title and message. Items go straight into the event lanes, bypassing
+// the ANCS client and the filter.
+
+enum ProtoError : uint8_t
+{
+    ProtoErrorUnknownType = 1,
+    ProtoErrorMalformed = 2
+};
+
+namespace BeeprProto
+{
+    // Feeds one received byte; a 0x00 completes a frame.
+    void feed(uint8_t c);
+}
+
+#endif
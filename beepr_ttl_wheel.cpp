@@ -0,0 +1,228 @@
+#include "beepr_ttl_wheel.h"
+
+#include <string.h>
+
+static const uint32_t BUCKET_MASK = TTL_WHEEL_BUCKETS - 1;
+// Furthest a timer can be filed ahead; later ones wait in the last level.
+static const uint32_t HORIZON_TICKS = (1UL << (TTL_WHEEL_BITS * TTL_WHEEL_LEVELS)) - 1;
+
+static void unlinkTimer(TtlWheel &wheel, uint8_t id)
+{
+    TtlTimer &t = wheel.timers[id];
+    if (t.prev != TTL_NO_TIMER)
+    {
+        wheel.timers[t.prev].next = t.next;
+    }
+    else
+    {
+        wheel.heads[t.bucket] = t.next;
+    }
+    if (t.next != TTL_NO_TIMER)
+    {
+        wheel.timers[t.next].prev = t.prev;
+    }
+    t.bucket = TTL_NO_TIMER;
+}
+
+// Files a timer by how far away it is: the finest level whose span still
+// reaches it. Bucket indices are absolute tick bits, so a bucket comes round
+// again exactly when its timers are due (level 0) or due to move down.
+static void fileTimer(TtlWheel &wheel, uint8_t id)
+{
+    TtlTimer &t = wheel.timers[id];
+    uint32_t target = t.expiresTick;
+    uint32_t delta = (int32_t)(target - wheel.tick) > 0 ? target - wheel.tick : 0;
+    if (delta > HORIZON_TICKS)
+    {
+        target = wheel.tick + HORIZON_TICKS;
+        delta = HORIZON_TICKS;
+    }
+
+    uint8_t level = 0;
+    while (level + 1 < TTL_WHEEL_LEVELS && delta >= (1UL << (TTL_WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    uint8_t bucket = (uint8_t)(level * TTL_WHEEL_BUCKETS + ((target >> (TTL_WHEEL_BITS * level)) & BUCKET_MASK));
+
+    t.bucket = bucket;
+    t.prev = TTL_NO_TIMER;
+    t.next = wheel.heads[bucket];
+    if (t.next != TTL_NO_TIMER)
+    {
+        wheel.timers[t.next].prev = id;
+    }
+    wheel.heads[bucket] = id;
+}
+
+// Moves every timer of a coarse bucket whose turn has come to a finer level.
+static void cascade(TtlWheel &wheel, uint8_t level)
+{
+    uint8_t bucket = (uint8_t)(level * TTL_WHEEL_BUCKETS + ((wheel.tick >> (TTL_WHEEL_BITS * level)) & BUCKET_MASK));
+    uint8_t id = wheel.heads[bucket];
+    wheel.heads[bucket] = TTL_NO_TIMER;
+    while (id != TTL_NO_TIMER)
+    {
+        uint8_t next = wheel.timers[id].next;
+        fileTimer(wheel, id);
+        wheel.cascaded++;
+        id = next;
+    }
+}
+
+// Ticks until step() next touches a non-empty bucket: a level 0 bucket fires
+// on its own tick, a coarser one cascades at the start of its span.
+// TTL_NO_DEADLINE with nothing armed.
+static uint32_t ticksUntilWork(const TtlWheel &wheel)
+{
+    uint32_t ticks = TTL_NO_DEADLINE;
+    if (wheel.armed == 0)
+    {
+        return ticks;
+    }
+    for (uint8_t level = 0; level < TTL_WHEEL_LEVELS; level++)
+    {
+        uint8_t shift = TTL_WHEEL_BITS * level;
+        uint32_t span = wheel.tick >> shift;
+        for (uint32_t k = 1; k <= TTL_WHEEL_BUCKETS; k++)
+        {
+            if (wheel.heads[level * TTL_WHEEL_BUCKETS + ((span + k) & BUCKET_MASK)] != TTL_NO_TIMER)
+            {
+                uint32_t at = ((span + k) << shift) - wheel.tick;
+                if (at < ticks)
+                {
+                    ticks = at;
+                }
+                break;
+            }
+        }
+    }
+    return ticks;
+}
+
+// Moves the wheel over ticks that touch no bucket.
+static void skipTicks(TtlWheel &wheel, uint32_t ticks)
+{
+    wheel.tick += ticks;
+    wheel.tickStartMs += ticks * TTL_TICK_MS;
+}
+
+static uint8_t step(TtlWheel &wheel, uint8_t *ids, uint8_t count)
+{
+    wheel.tick++;
+    wheel.tickStartMs += TTL_TICK_MS;
+    wheel.steps++;
+
+    // Coarsest first: a timer coming down from level 2 may land in the
+    // level 1 bucket that is about to cascade too.
+    for (uint8_t level = TTL_WHEEL_LEVELS - 1; level > 0; level--)
+    {
+        uint32_t below = (1UL << (TTL_WHEEL_BITS * level)) - 1;
+        if ((wheel.tick & below) == 0)
+        {
+            cascade(wheel, level);
+        }
+    }
+
+    uint8_t bucket = (uint8_t)(wheel.tick & BUCKET_MASK);
+    while (wheel.heads[bucket] != TTL_NO_TIMER)
+    {
+        uint8_t id = wheel.heads[bucket];
+        unlinkTimer(wheel, id);
+        wheel.armed--;
+        wheel.fired++;
+        ids[count++] = id;
+    }
+    return count;
+}
+
+void BeeprTtlWheel::reset(TtlWheel &wheel, uint32_t nowMs)
+{
+    wheel = TtlWheel();
+    wheel.tickStartMs = nowMs;
+    memset(wheel.heads, TTL_NO_TIMER, sizeof(wheel.heads));
+    for (uint8_t i = 0; i < TTL_WHEEL_TIMERS; i++)
+    {
+        wheel.timers[i].bucket = TTL_NO_TIMER;
+    }
+}
+
+void BeeprTtlWheel::arm(TtlWheel &wheel, uint8_t id, uint32_t delayMs, uint32_t nowMs)
+{
+    if (id >= TTL_WHEEL_TIMERS)
+    {
+        return;
+    }
+    cancel(wheel, id);
+    if (wheel.armed == 0)
+    {
+        // Nobody calls advance() while nothing is armed; catch up so the lag
+        // is neither added to this timer nor stepped through later.
+        skipTicks(wheel, (nowMs - wheel.tickStartMs) / TTL_TICK_MS);
+    }
+    // Counted from the start of the current tick, which may lag nowMs by
+    // less than a tick, or more if advance() has not caught up yet.
+    uint64_t fromTickMs = (uint64_t)(nowMs - wheel.tickStartMs) + delayMs;
+    uint64_t ticks = (fromTickMs + TTL_TICK_MS - 1) / TTL_TICK_MS;
+    if (ticks == 0)
+    {
+        ticks = 1;
+    }
+    if (ticks > 0x7FFFFFFFULL)
+    {
+        ticks = 0x7FFFFFFFULL;
+    }
+    wheel.timers[id].expiresTick = wheel.tick + (uint32_t)ticks;
+    fileTimer(wheel, id);
+    wheel.armed++;
+    wheel.arms++;
+}
+
+void BeeprTtlWheel::cancel(TtlWheel &wheel, uint8_t id)
+{
+    if (id >= TTL_WHEEL_TIMERS || wheel.timers[id].bucket == TTL_NO_TIMER)
+    {
+        return;
+    }
+    unlinkTimer(wheel, id);
+    wheel.armed--;
+    wheel.cancels++;
+}
+
+bool BeeprTtlWheel::armed(const TtlWheel &wheel, uint8_t id)
+{
+    return id < TTL_WHEEL_TIMERS && wheel.timers[id].bucket != TTL_NO_TIMER;
+}
+
+uint8_t BeeprTtlWheel::advance(TtlWheel &wheel, uint32_t nowMs, uint8_t ids[TTL_WHEEL_TIMERS])
+{
+    uint8_t count = 0;
+    while (nowMs - wheel.tickStartMs >= TTL_TICK_MS)
+    {
+        // Jump over the stretch where no bucket fires or cascades, so a
+        // long gap costs a step per timer event rather than per tick.
+        uint32_t due = (nowMs - wheel.tickStartMs) / TTL_TICK_MS;
+        uint32_t work = ticksUntilWork(wheel);
+        if (work > due)
+        {
+            skipTicks(wheel, due);
+            break;
+        }
+        skipTicks(wheel, work - 1);
+        count = step(wheel, ids, count);
+    }
+    return count;
+}
+
+uint32_t BeeprTtlWheel::msUntilNext(const TtlWheel &wheel, uint32_t nowMs)
+{
+    uint32_t ticks = ticksUntilWork(wheel);
+    if (ticks == TTL_NO_DEADLINE)
+    {
+        return TTL_NO_DEADLINE;
+    }
+
+    uint64_t dueMs = (uint64_t)ticks * TTL_TICK_MS;
+    uint32_t intoTickMs = nowMs - wheel.tickStartMs;
+    return dueMs > intoTickMs ? (uint32_t)(dueMs - intoTickMs) : 0;
+}
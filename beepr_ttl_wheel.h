@@ -0,0 +1,64 @@
+#ifndef BEEPR_TTL_WHEEL_H
+#define BEEPR_TTL_WHEEL_H
+
+#include <stdint.h>
+
+// Hierarchical timer wheel for notification expiry. Pure logic on
+// caller-supplied timestamps with no Arduino or IDF dependencies, so it
+// builds and runs unchanged on a host.
+//
+// Three levels of 64 buckets, at 1 s, 64 s and 4096 s per bucket, reach
+// about 72 hours; anything further is parked in the last bucket and re-filed
+// as it comes closer. Timers are fixed nodes named by a caller-chosen id
+// (the store slot) and linked into their bucket, so arm and cancel are O(1)
+// and nothing is allocated. A timer moves down a level at most twice before
+// it fires.
+
+static const uint32_t TTL_TICK_MS = 1000;
+static const uint8_t TTL_WHEEL_BITS = 6;
+static const uint8_t TTL_WHEEL_LEVELS = 3;
+static const uint8_t TTL_WHEEL_BUCKETS = 1 << TTL_WHEEL_BITS;
+static const uint8_t TTL_WHEEL_TIMERS = 32;
+static const uint8_t TTL_NO_TIMER = 0xFF;
+static const uint32_t TTL_NO_DEADLINE = 0xFFFFFFFFUL;
+
+struct TtlTimer
+{
+    uint32_t expiresTick;
+    uint8_t prev;
+    uint8_t next;
+    uint8_t bucket; // level * TTL_WHEEL_BUCKETS + index, TTL_NO_TIMER if idle.
+};
+
+struct TtlWheel
+{
+    uint32_t tick;        // Ticks processed so far.
+    uint32_t tickStartMs; // When the current tick began.
+    uint8_t heads[TTL_WHEEL_LEVELS * TTL_WHEEL_BUCKETS];
+    TtlTimer timers[TTL_WHEEL_TIMERS];
+    uint8_t armed;
+
+    uint32_t arms;
+    uint32_t cancels;
+    uint32_t fired;
+    uint32_t cascaded; // Re-filed into a finer level.
+    uint32_t steps;    // Ticks stepped one by one; idle stretches are skipped.
+};
+
+namespace BeeprTtlWheel
+{
+    void reset(TtlWheel &wheel, uint32_t nowMs);
+    // (Re)arms timer id to fire delayMs after nowMs, rounded up to a tick.
+    void arm(TtlWheel &wheel, uint8_t id, uint32_t delayMs, uint32_t nowMs);
+    // Idle timers are ignored.
+    void cancel(TtlWheel &wheel, uint8_t id);
+    bool armed(const TtlWheel &wheel, uint8_t id);
+    // Runs the wheel up to nowMs and stores the ids of the timers that fired,
+    // which are then idle. Returns how many did.
+    uint8_t advance(TtlWheel &wheel, uint32_t nowMs, uint8_t ids[TTL_WHEEL_TIMERS]);
+    // Time until advance() has work to do (a timer fires or moves down a
+    // level), 0 if overdue, TTL_NO_DEADLINE with nothing armed.
+    uint32_t msUntilNext(const TtlWheel &wheel, uint32_t nowMs);
+}
+
+#endif
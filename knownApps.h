@@ -231,47 +231,58 @@ static const AppNameEntry kAppNames[] = {
     {"com.duolingo.DuolingoMobile", "Duolingo"},
 };
 
-static inline String normalizeBundleId(String value)
+static const size_t kAppNameCount = sizeof(kAppNames) / sizeof(kAppNames[0]);
+
+static inline bool isBundleIdTrimChar(char c)
 {
-    value.trim();
-    value.toLowerCase();
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
 
-    if (value.startsWith("\"") && value.endsWith("\"") && value.length() >= 2)
+// Narrows [s, s + len) to the bundle id proper: surrounding whitespace and
+// quotes are dropped. Works in place on the caller's buffer, no allocation.
+static inline void trimBundleId(const char *&s, size_t &len)
+{
+    while (len && isBundleIdTrimChar(*s))
+    {
+        s++;
+        len--;
+    }
+    while (len && isBundleIdTrimChar(s[len - 1]))
     {
-        value = value.substring(1, value.length() - 1);
-        value.trim();
+        len--;
+    }
+    if (len >= 2 && s[0] == '"' && s[len - 1] == '"')
+    {
+        s++;
+        len -= 2;
+        trimBundleId(s, len);
     }
-    return value;
 }
 
-static inline bool bundleIdMatches(const String &normalizedIncoming, const char *knownBundleId)
+static inline bool bundleIdMatches(const char *incoming, size_t incomingLen, const char *knownBundleId)
 {
-    String normalizedKnown = normalizeBundleId(String(knownBundleId));
-    if (normalizedIncoming == normalizedKnown)
+    size_t knownLen = strlen(knownBundleId);
+    if (incomingLen < knownLen)
     {
-        return true;
+        return false;
     }
 
-    // Some ANCS payloads may include prefixes/suffixes around bundle id.
-    if (normalizedIncoming.endsWith(normalizedKnown))
-    {
-        return true;
-    }
-    return false;
+    // Exact match, or some ANCS payloads may include prefixes around bundle id.
+    return strncasecmp(incoming + incomingLen - knownLen, knownBundleId, knownLen) == 0;
 }
 
-static inline String getAppName(const String &bundleId)
+// Returns the kAppNames index for a bundle id, or -1 when unknown.
+static inline int findAppIndex(const char *bundleId, size_t len)
 {
-    String normalizedIncoming = normalizeBundleId(bundleId);
-
-    for (size_t i = 0; i < (sizeof(kAppNames) / sizeof(kAppNames[0])); ++i)
+    trimBundleId(bundleId, len);
+    for (size_t i = 0; i < kAppNameCount; ++i)
     {
-        if (bundleIdMatches(normalizedIncoming, kAppNames[i].bundleId))
+        if (bundleIdMatches(bundleId, len, kAppNames[i].bundleId))
         {
-            return kAppNames[i].appName;
+            return (int)i;
         }
     }
-    return bundleId;
+    return -1;
 }
 
 #endif
@@ -0,0 +1,162 @@
+// Render cost on the host: microseconds per call for each compose path on a
+// 128x64 framebuffer. Not run by `make all`; use `make -C tests bench`.
+//
+// With U8G2_DIR set (make -C tests bench U8G2_DIR=.../U8g2/src/clib) a full
+// notification frame is also composed the old way, with u8g2_DrawStr() for
+// every line, next to the glyph atlas captured from the same u8g2 font, and
+// both numbers are printed. Without it the atlas paths run on the synthetic
+// atlas. Host numbers only rank changes against each other; on the device,
+// `disp bench` times the same frame both ways.
+
+#include "beepr_panel_fb.h"
+#include "beepr_display_compose.h"
+#include "synthetic_atlas.h"
+
+#include <chrono>
+#include <string.h>
+
+typedef FramebufferPanel<128, 64> Panel;
+
+static const char *MESSAGE = "Running late, see you at the station at seven!";
+static const int ITERATIONS = 200000;
+
+static GlyphAtlas atlas;
+static Panel panel;
+static volatile uint8_t sink;
+
+template <class Fn>
+static double bench(const char *name, const uint8_t *frame, Fn fn)
+{
+    for (int i = 0; i < ITERATIONS / 10; i++)
+    {
+        fn(i);
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        fn(i);
+        sink = frame[i & 1023];
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %8.3f us\n", name, us / ITERATIONS);
+    return us / ITERATIONS;
+}
+
+#ifdef BEEPR_TEST_U8G2
+#include "u8g2.h"
+
+// What the device's U8g2Panel does without an atlas, on u8g2's C API: text
+// through u8g2_DrawStr(), widths through u8g2_GetStrWidth().
+class U8g2HostPanel : public BeeprPanel<U8g2HostPanel>
+{
+public:
+    static const int16_t WIDTH = 128;
+    static const int16_t HEIGHT = 64;
+
+    void panelBegin()
+    {
+        u8g2_Setup_ssd1306_128x64_noname_f(&u8g2, U8G2_R0, u8x8_byte_empty, u8x8_dummy_cb);
+        u8g2_SetFont(&u8g2, u8g2_font_6x12_tr);
+    }
+
+    uint8_t *panelFrame()
+    {
+        return u8g2_GetBufferPtr(&u8g2);
+    }
+
+    void panelTransfer()
+    {
+    }
+
+    void panelTransferRows(uint8_t tileRow, uint8_t tileRows)
+    {
+        (void)tileRow;
+        (void)tileRows;
+    }
+
+    void panelPowerSave(bool enable)
+    {
+        (void)enable;
+    }
+
+    int16_t panelMeasure(const char *text)
+    {
+        return (int16_t)u8g2_GetStrWidth(&u8g2, text);
+    }
+
+    void panelDrawText(int16_t x, int16_t baseline, const char *text)
+    {
+        u8g2_DrawStr(&u8g2, (u8g2_uint_t)x, (u8g2_uint_t)baseline, text);
+    }
+
+    // As U8g2Panel::decodeGlyphs(): one glyph at a time at column 0.
+    void captureAtlas(GlyphAtlas &out)
+    {
+        memset(&out, 0, sizeof(out));
+        for (uint8_t i = 0; i < GLYPH_ATLAS_COUNT; i++)
+        {
+            char c = (char)(GLYPH_ATLAS_FIRST + i);
+            u8g2_ClearBuffer(&u8g2);
+            u8g2_DrawGlyph(&u8g2, 0, GLYPH_ATLAS_ASCENT, (uint16_t)(uint8_t)c);
+            BeeprGlyphAtlas::capture(out, c, u8g2_GetBufferPtr(&u8g2), WIDTH, 0);
+        }
+        u8g2_ClearBuffer(&u8g2);
+    }
+
+private:
+    u8g2_t u8g2;
+};
+
+static U8g2HostPanel u8g2Panel;
+
+// Old against new on one full notification frame, same font, same output.
+static void compareWithU8g2()
+{
+    u8g2Panel.begin();
+    u8g2Panel.captureAtlas(atlas);
+    static uint8_t reference[1024];
+
+    u8g2Panel.setAtlas(nullptr);
+    double oldUs = bench("full frame, u8g2_DrawStr", u8g2Panel.frame(), [](int) {
+        composeNotification(u8g2Panel, "Mail", "Bob Appleseed", MESSAGE, 3, 4, 12, "59m");
+    });
+    memcpy(reference, u8g2Panel.frame(), sizeof(reference));
+
+    u8g2Panel.setAtlas(&atlas);
+    double newUs = bench("full frame, glyph atlas", u8g2Panel.frame(), [](int) {
+        composeNotification(u8g2Panel, "Mail", "Bob Appleseed", MESSAGE, 3, 4, 12, "59m");
+    });
+    bool identical = memcmp(reference, u8g2Panel.frame(), sizeof(reference)) == 0;
+    printf("atlas/u8g2 %.2fx faster, output %s\n\n", newUs > 0 ? oldUs / newUs : 0.0,
+           identical ? "identical" : "DIFFERS");
+}
+#endif
+
+int main()
+{
+#ifdef BEEPR_TEST_U8G2
+    compareWithU8g2();
+#else
+    buildSyntheticAtlas(atlas);
+    printf("synthetic atlas; build with U8G2_DIR=... to compare against u8g2_DrawStr\n");
+#endif
+    panel.setAtlas(&atlas);
+    panel.begin();
+    size_t messageLen = strlen(MESSAGE);
+    int16_t width = panel.textWidth(MESSAGE) + 4 * GLYPH_ATLAS_WIDTH;
+    const uint8_t *frame = panel.frame();
+
+    bench("composeNotification", frame, [](int) {
+        composeNotification(panel, "Mail", "Bob Appleseed", MESSAGE, 3, 4, 12, "59m");
+    });
+    bench("composeMessageBand", frame, [&](int i) {
+        composeMessageBand(panel, MESSAGE, messageLen, (int16_t)(i % width), width);
+    });
+    bench("composeAge", frame, [](int i) {
+        composeAge(panel, (i & 1) ? "5m" : "now");
+    });
+    bench("composeStatus", frame, [](int) {
+        composeStatus(panel, "BEEPR ready", "Waiting for phone");
+    });
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <stdio.h>
+
+// Minimal assertions: report every failure, exit non-zero at the end.
+static int checkFailures = 0;
+
+#define CHECK(cond)                                                               \
+    do                                                                            \
+    {                                                                             \
+        if (!(cond))                                                              \
+        {                                                                         \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            checkFailures++;                                                      \
+        }                                                                         \
+    } while (0)
+
+static int checkResult(const char *name)
+{
+    printf("%s: %s\n", name, checkFailures ? "FAIL" : "ok");
+    return checkFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the firmware's pure-C++ modules
+// on a host. Time is a fake clock the tests move with hostAdvanceMs().
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "esp_attr.h"
+
+#ifndef ESP_ARDUINO_VERSION_MAJOR
+#define ESP_ARDUINO_VERSION_MAJOR 2
+#endif
+
+class String
+{
+public:
+    String(const char *s = "");
+    String(const String &other);
+    ~String();
+    String &operator=(const String &other);
+    const char *c_str() const { return buf; }
+    unsigned length() const { return len; }
+
+private:
+    char *buf;
+    unsigned len;
+};
+
+// Print::printf of the ESP32 core: formats into a 64-byte stack buffer and
+// mallocs a bigger one for anything longer, which the tests count.
+class HardwareSerial
+{
+public:
+    void begin(unsigned long) {}
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t write(const uint8_t *data, size_t len);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t println(const char *s) { return print(s) + print("\n"); }
+    size_t println() { return print("\n"); }
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() {}
+
+    // Everything written, for assertions; cleared by the tests.
+    char captured[4096];
+    size_t capturedLen;
+};
+extern HardwareSerial Serial;
+
+struct EspClass
+{
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFreeHeap() { return 0; }
+};
+extern EspClass ESP;
+
+uint32_t millis();
+uint32_t micros();
+bool psramFound();
+// What psramFound() reports; set before BeeprNotifs::begin().
+extern bool hostPsram;
+void hostAdvanceMs(uint32_t ms);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+// Empty NVS: every key reads back its default.
+class Preferences
+{
+public:
+    bool begin(const char *, bool = false) { return true; }
+    void end() {}
+    String getString(const char *, const String &fallback = String()) { return fallback; }
+    size_t putString(const char *, const char *value) { return strlen(value); }
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef HOST_ESP32NOTIFICATIONS_H
+#define HOST_ESP32NOTIFICATIONS_H
+
+#include <Arduino.h>
+
+enum NotificationCategory
+{
+    CategoryIDOther = 0,
+    CategoryIDIncomingCall = 1,
+    CategoryIDMissedCall = 2,
+    CategoryIDVoicemail = 3,
+    CategoryIDSocial = 4,
+    CategoryIDSchedule = 5,
+    CategoryIDEmail = 6,
+    CategoryIDNews = 7,
+    CategoryIDHealthAndFitness = 8,
+    CategoryIDBusinessAndFinance = 9,
+    CategoryIDLocation = 10,
+    CategoryIDEntertainment = 11
+};
+
+#endif
@@ -0,0 +1,38 @@
+// Stand-ins for the modules that drive hardware (panel, alert outputs,
+// power). They only record what they were asked to do.
+
+#include "beepr_alert.h"
+#include "beepr_display.h"
+#include "beepr_power.h"
+#include "fake_device.h"
+
+FakeDeviceCounts fakeDevice;
+
+uint8_t BeeprAlert::patternFor(uint8_t, const char *)
+{
+    return BeeprAlert::PATTERN_NONE;
+}
+
+void BeeprAlert::play(uint8_t)
+{
+    fakeDevice.alerts++;
+}
+
+void BeeprDisplay::showNotification(const char *, const char *, const char *, size_t, size_t, size_t, uint32_t)
+{
+    fakeDevice.renders++;
+}
+
+uint32_t BeeprDisplay::refreshAge(uint32_t)
+{
+    return 0xFFFFFFFFUL;
+}
+
+void BeeprDisplay::showEmpty()
+{
+    fakeDevice.renders++;
+}
+
+void BeeprPower::noteNotification()
+{
+}
@@ -0,0 +1,14 @@
+#ifndef HOST_FAKE_DEVICE_H
+#define HOST_FAKE_DEVICE_H
+
+#include <stdint.h>
+
+struct FakeDeviceCounts
+{
+    uint32_t renders;
+    uint32_t alerts;
+};
+
+extern FakeDeviceCounts fakeDevice;
+
+#endif
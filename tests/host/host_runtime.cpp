@@ -0,0 +1,253 @@
+// Host implementations of the Arduino, FreeRTOS and IDF calls declared in
+// this directory. Single-threaded: mutexes always succeed, queues are plain
+// rings, and waiting on anything just moves the fake clock.
+
+#include <Arduino.h>
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static uint64_t nowUs = 0;
+
+void hostAdvanceMs(uint32_t ms)
+{
+    nowUs += (uint64_t)ms * 1000;
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(nowUs / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)nowUs;
+}
+
+bool hostPsram = false;
+
+bool psramFound()
+{
+    return hostPsram;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)(nowUs * 240);
+}
+
+String::String(const char *s)
+{
+    len = (unsigned)strlen(s);
+    buf = (char *)malloc(len + 1);
+    memcpy(buf, s, len + 1);
+}
+
+String::String(const String &other) : String(other.buf)
+{
+}
+
+String::~String()
+{
+    free(buf);
+}
+
+String &String::operator=(const String &other)
+{
+    if (this != &other)
+    {
+        String copy(other);
+        char *swap = buf;
+        buf = copy.buf;
+        copy.buf = swap;
+        len = copy.len;
+    }
+    return *this;
+}
+
+int HardwareSerial::printf(const char *format, ...)
+{
+    char stackBuf[64];
+    char *out = stackBuf;
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len >= (int)sizeof(stackBuf))
+    {
+        out = (char *)malloc(len + 1);
+        va_start(args, format);
+        vsnprintf(out, len + 1, format, args);
+        va_end(args);
+    }
+    if (len > 0)
+    {
+        write((const uint8_t *)out, (size_t)len);
+    }
+    if (out != stackBuf)
+    {
+        free(out);
+    }
+    return len;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t len)
+{
+    size_t room = sizeof(captured) - 1 - capturedLen;
+    size_t n = len < room ? len : room;
+    memcpy(captured + capturedLen, data, n);
+    capturedLen += n;
+    captured[capturedLen] = '\0';
+    return len;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t)
+{
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t)
+{
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t)
+{
+    return 256 * 1024;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t)
+{
+    return 256 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t)
+{
+    return 128 * 1024;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+struct HostQueue
+{
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    HostQueue *queue = (HostQueue *)calloc(1, sizeof(HostQueue));
+    queue->items = (uint8_t *)calloc(length ? length : 1, itemSize ? itemSize : 1);
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t)
+{
+    if (queue->count == queue->length)
+    {
+        return pdFALSE;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + tail * queue->itemSize, item, queue->itemSize);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t)
+{
+    if (queue->count == 0)
+    {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items + queue->head * queue->itemSize, queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    return queue->length - queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return xQueueCreate(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t)
+{
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t)
+{
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t)
+{
+    if (handle)
+    {
+        *handle = nullptr;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t)
+{
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    hostAdvanceMs(ticks);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return nullptr;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t wait)
+{
+    if (wait != portMAX_DELAY)
+    {
+        hostAdvanceMs(wait);
+    }
+    return 0;
+}
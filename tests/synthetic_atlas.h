@@ -0,0 +1,30 @@
+#ifndef TESTS_SYNTHETIC_ATLAS_H
+#define TESTS_SYNTHETIC_ATLAS_H
+
+#include "beepr_glyph_atlas.h"
+
+#include <string.h>
+
+// Deterministic stand-in for the atlas `disp atlas` prints on a device: five
+// inked columns and a gap per glyph, rows 0-13 of the glyph box, with the
+// same pixel rule as test_glyph_atlas's reference font.
+static void buildSyntheticAtlas(GlyphAtlas &atlas)
+{
+    memset(&atlas, 0, sizeof(atlas));
+    for (uint8_t i = 0; i < GLYPH_ATLAS_COUNT; i++)
+    {
+        uint8_t c = (uint8_t)(GLYPH_ATLAS_FIRST + i);
+        for (int16_t col = 0; c != ' ' && col < GLYPH_ATLAS_WIDTH - 1; col++)
+        {
+            for (int16_t row = 0; row < 14; row++)
+            {
+                if ((c + col * 3 + row * 5) % 7 == 0)
+                {
+                    atlas.columns[i][col] |= (uint16_t)(1u << row);
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,93 @@
+// BeeprAdvState: stepping down the schedule, activity resets, connect
+// statistics and the deadline the BLE task sleeps until.
+
+#include "beepr_adv_state.h"
+#include "check.h"
+
+static const AdvStep steps[] = {{32, 1000}, {244, 2000}, {2056, 0}};
+static const uint8_t stepCount = sizeof(steps) / sizeof(steps[0]);
+
+static void schedule()
+{
+    AdvState a;
+    BeeprAdvState::reset(a);
+    CHECK(BeeprAdvState::start(a, steps, stepCount, 100) == AdvActionRestart);
+    CHECK(BeeprAdvState::intervalUnits(a) == 32);
+    CHECK(BeeprAdvState::msUntilTick(a, 100) == 1000);
+
+    CHECK(BeeprAdvState::onTick(a, 1099) == AdvActionNone);
+    CHECK(BeeprAdvState::onTick(a, 1100) == AdvActionRestart);
+    CHECK(a.step == 1);
+    CHECK(BeeprAdvState::intervalUnits(a) == 244);
+
+    // Activity restarts the fast window once; more activity in it is ignored.
+    CHECK(BeeprAdvState::onActivity(a, 1500) == AdvActionRestart);
+    CHECK(a.step == 0);
+    CHECK(a.activityResets == 1);
+    CHECK(BeeprAdvState::onActivity(a, 1600) == AdvActionNone);
+
+    CHECK(BeeprAdvState::onTick(a, 2500) == AdvActionRestart);
+    CHECK(BeeprAdvState::onTick(a, 4500) == AdvActionRestart);
+    CHECK(a.step == 2);
+    // The last step holds until connected.
+    CHECK(BeeprAdvState::msUntilTick(a, 4500) == ADV_NO_DEADLINE);
+    CHECK(BeeprAdvState::onTick(a, 999999) == AdvActionNone);
+
+    BeeprAdvState::onConnected(a, 10100);
+    CHECK(a.connects == 1);
+    CHECK(a.lastConnectMs == 10000);
+    CHECK(a.connectsAtStep[2] == 1);
+    CHECK(BeeprAdvState::stepResidency(a, 0, 20000) == 2000);
+    CHECK(BeeprAdvState::stepResidency(a, 1, 20000) == 400 + 2000);
+    CHECK(BeeprAdvState::stepResidency(a, 2, 20000) == 10100 - 4500);
+
+    // Connected: nothing to do and nothing to wake for.
+    CHECK(BeeprAdvState::onActivity(a, 20000) == AdvActionNone);
+    CHECK(BeeprAdvState::onTick(a, 20000) == AdvActionNone);
+    CHECK(BeeprAdvState::msUntilTick(a, 20000) == ADV_NO_DEADLINE);
+
+    BeeprAdvState::start(a, steps, stepCount, 30000);
+    BeeprAdvState::onConnected(a, 30500);
+    CHECK(a.connects == 2);
+    CHECK(a.minConnectMs == 500);
+    CHECK(a.maxConnectMs == 10000);
+}
+
+// Sleeping exactly until msUntilTick() and ticking then walks the schedule
+// with one wake per step, across the millis() wrap.
+static void deadlineWalk()
+{
+    AdvState a;
+    BeeprAdvState::reset(a);
+    uint32_t nowMs = 0xFFFFFF00UL;
+    BeeprAdvState::start(a, steps, stepCount, nowMs);
+    int wakes = 0;
+    for (;;)
+    {
+        uint32_t waitMs = BeeprAdvState::msUntilTick(a, nowMs);
+        if (waitMs == ADV_NO_DEADLINE)
+        {
+            break;
+        }
+        CHECK(BeeprAdvState::onTick(a, nowMs + waitMs - 1) == AdvActionNone);
+        nowMs += waitMs;
+        CHECK(BeeprAdvState::onTick(a, nowMs) == AdvActionRestart);
+        wakes++;
+        CHECK(wakes <= stepCount);
+        if (wakes > stepCount)
+        {
+            break;
+        }
+    }
+    CHECK(wakes == stepCount - 1);
+    CHECK(a.step == stepCount - 1);
+    CHECK(BeeprAdvState::stepResidency(a, 0, nowMs) == 1000);
+    CHECK(BeeprAdvState::stepResidency(a, 1, nowMs) == 2000);
+}
+
+int main()
+{
+    schedule();
+    deadlineWalk();
+    return checkResult("test_adv_state");
+}
@@ -0,0 +1,96 @@
+// BeeprAlertSeq: pattern timing, loops, and the preempt / coalesce / ignore
+// rules a reconnect burst relies on.
+
+#include "beepr_alert_seq.h"
+#include "check.h"
+
+static const uint8_t beep[] = {ALERT_TONE(2000), ALERT_LED(255), ALERT_WAIT(50), ALERT_TONE(0), ALERT_WAIT(30),
+                               ALERT_LOOP(1), ALERT_END};
+static const uint8_t ring[] = {ALERT_VIB(200), ALERT_WAIT(100), ALERT_END};
+
+static void timing()
+{
+    AlertSeqState s;
+    BeeprAlertSeq::reset(s);
+    CHECK(!BeeprAlertSeq::tick(s));
+    CHECK(BeeprAlertSeq::request(s, beep, 0, 0, 1000) == AlertStarted);
+
+    // Two passes of 50 ms tone and 30 ms silence, at 10 ms a tick.
+    int ticks = 0;
+    int toneTicks = 0;
+    while (BeeprAlertSeq::tick(s))
+    {
+        ticks++;
+        toneTicks += s.out.toneHz == 2000;
+        CHECK(ticks <= 100);
+        if (ticks > 100)
+        {
+            break;
+        }
+    }
+    CHECK(ticks == 16);
+    CHECK(toneTicks == 10);
+    CHECK(!s.playing);
+    CHECK(s.out.toneHz == 0 && s.out.led == 0 && s.out.vib == 0);
+}
+
+static void arbitration()
+{
+    AlertSeqState s;
+    BeeprAlertSeq::reset(s);
+    BeeprAlertSeq::request(s, beep, 0, 0, 1000);
+    while (BeeprAlertSeq::tick(s))
+    {
+    }
+
+    // Same priority within the coalesce window of the last start: folded in.
+    CHECK(BeeprAlertSeq::request(s, beep, 0, 500, 1000) == AlertCoalesced);
+    CHECK(BeeprAlertSeq::request(s, beep, 0, 1000, 1000) == AlertStarted);
+    BeeprAlertSeq::tick(s);
+    CHECK(BeeprAlertSeq::request(s, beep, 0, 1010, 1000) == AlertCoalesced);
+
+    // More urgent: cuts the beep off with its outputs cleared.
+    CHECK(BeeprAlertSeq::request(s, ring, 2, 1020, 1000) == AlertPreempted);
+    CHECK(s.out.toneHz == 0);
+    BeeprAlertSeq::tick(s);
+    CHECK(s.out.vib == 200);
+
+    // Less urgent while the ring plays: dropped.
+    CHECK(BeeprAlertSeq::request(s, beep, 1, 1030, 1000) == AlertIgnored);
+    int ticks = 0;
+    while (BeeprAlertSeq::tick(s))
+    {
+        ticks++;
+    }
+    CHECK(ticks == 9);
+    CHECK(s.started == 3);
+    CHECK(s.preempted == 1);
+    CHECK(s.coalesced == 2);
+    CHECK(s.ignored == 1);
+    CHECK(BeeprAlertSeq::request(s, nullptr, 9, 5000, 0) == AlertIgnored);
+}
+
+// A pattern with no Wait still ends: loops are bounded and each tick runs a
+// bounded number of ops.
+static void noWait()
+{
+    static const uint8_t spin[] = {ALERT_LED(1), ALERT_LOOP(255), ALERT_END};
+    AlertSeqState s;
+    BeeprAlertSeq::reset(s);
+    BeeprAlertSeq::request(s, spin, 9, 99999, 0);
+    int ticks = 0;
+    while (BeeprAlertSeq::tick(s) && ticks < 1000)
+    {
+        ticks++;
+    }
+    CHECK(ticks < 1000);
+    CHECK(!s.playing);
+}
+
+int main()
+{
+    timing();
+    arbitration();
+    noWait();
+    return checkResult("test_alert_seq");
+}
@@ -0,0 +1,98 @@
+// App groups are keyed by a hash of the app name. Two names with the same
+// FNV-1a hash must still be two groups: counted apart, jumped between, and
+// cleared one at a time.
+
+#include "beepr_flightrec.h"
+#include "beepr_notifs.h"
+#include "check.h"
+#include "fake_device.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Both hash to 0x7f8e931f.
+static const char *APP_A = "gUsZLunf";
+static const char *APP_B = "gJhxMmxK";
+
+static void addEntry(uint32_t uid, const char *app)
+{
+    uint16_t index = BeeprNotifs::claimRecord();
+    NotifRecord *rec = BeeprNotifs::record(index);
+    CHECK(rec != nullptr);
+    if (!rec)
+    {
+        return;
+    }
+    snprintf(rec->app, sizeof(rec->app), "%s", app);
+    snprintf(rec->title, sizeof(rec->title), "title %lu", (unsigned long)uid);
+    rec->message[0] = '\0';
+    BeeprNotifs::add(index, uid, 0);
+}
+
+// App of the entry on screen, with its view counts.
+static bool current(char *app, size_t size, uint8_t &appCount, uint8_t &appGroups, uint16_t &total)
+{
+    const NotifView *view = BeeprNotifs::acquireView();
+    bool has = view && view->hasNotification;
+    if (has)
+    {
+        snprintf(app, size, "%s", BeeprNotifs::record(view->record)->app);
+        appCount = view->appCount;
+        appGroups = view->appGroups;
+        total = view->total;
+    }
+    BeeprNotifs::releaseView(view);
+    return has;
+}
+
+int main()
+{
+    BeeprFlightRec::begin();
+    BeeprNotifs::begin();
+
+    addEntry(1, APP_A);
+    addEntry(2, APP_B);
+    addEntry(3, APP_A);
+    addEntry(4, "Mail");
+    addEntry(5, APP_B);
+    addEntry(6, APP_A);
+
+    char app[NOTIF_APP_LEN];
+    uint8_t appCount = 0;
+    uint8_t appGroups = 0;
+    uint16_t total = 0;
+    CHECK(current(app, sizeof(app), appCount, appGroups, total));
+    CHECK(strcmp(app, APP_A) == 0);
+    CHECK(appCount == 3);
+    CHECK(appGroups == 3);
+
+    // Groups are in order of first arrival: A, B, Mail.
+    BeeprNotifs::nextApp();
+    CHECK(current(app, sizeof(app), appCount, appGroups, total));
+    CHECK(strcmp(app, APP_B) == 0);
+    CHECK(appCount == 2);
+
+    // Clearing B leaves A's entries alone.
+    CHECK(BeeprNotifs::clearCurrentApp() == 2);
+    CHECK(current(app, sizeof(app), appCount, appGroups, total));
+    CHECK(strcmp(app, "Mail") == 0);
+    CHECK(total == 4);
+    CHECK(appGroups == 2);
+    CHECK(BeeprNotifs::findIndexByUid(1) >= 0);
+    CHECK(BeeprNotifs::findIndexByUid(2) < 0);
+    CHECK(BeeprNotifs::findIndexByUid(5) < 0);
+
+    // A group stays reachable once its first entry is gone.
+    CHECK(BeeprNotifs::removeByUid(1));
+    BeeprNotifs::nextApp();
+    CHECK(current(app, sizeof(app), appCount, appGroups, total));
+    CHECK(strcmp(app, APP_A) == 0);
+    CHECK(appCount == 2);
+    addEntry(7, APP_B);
+    CHECK(current(app, sizeof(app), appCount, appGroups, total));
+    CHECK(strcmp(app, APP_B) == 0);
+    CHECK(appCount == 1);
+    CHECK(appGroups == 3);
+
+    return checkResult("test_app_groups");
+}
@@ -0,0 +1,141 @@
+// Screens composed into a FramebufferPanel, compared byte for byte with the
+// PNGs checked in under golden/. Text uses the synthetic atlas, so the images
+// pin the layout, clipping and margins rather than the font.
+//
+// Run from tests/ (make does). A frame that differs is written to
+// build/golden/ next to the expected one; after an intended layout change,
+// `make -C tests update-golden` rewrites golden/ and the new images go into
+// the same commit.
+
+#include "beepr_panel_fb.h"
+#include "beepr_display_compose.h"
+#include "check.h"
+#include "synthetic_atlas.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef FramebufferPanel<128, 64> Panel;
+
+static const char *GOLDEN_DIR = "golden";
+static const char *OUTPUT_DIR = "build/golden";
+static const size_t IMAGE_MAX = 4096;
+
+static GlyphAtlas atlas;
+static bool update = false;
+
+static size_t readFile(const char *path, uint8_t *out, size_t size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return 0;
+    }
+    size_t len = fread(out, 1, size, file);
+    fclose(file);
+    return len;
+}
+
+static bool writeFrame(const Panel &panel, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "cannot write %s\n", path);
+        return false;
+    }
+    bool ok = panel.writePng(file);
+    return fclose(file) == 0 && ok;
+}
+
+static void checkGolden(const Panel &panel, const char *name)
+{
+    char goldenPath[96];
+    char outputPath[96];
+    snprintf(goldenPath, sizeof(goldenPath), "%s/%s.png", GOLDEN_DIR, name);
+    snprintf(outputPath, sizeof(outputPath), "%s/%s.png", OUTPUT_DIR, name);
+    if (update)
+    {
+        CHECK(writeFrame(panel, goldenPath));
+        return;
+    }
+
+    static uint8_t actual[IMAGE_MAX];
+    static uint8_t expected[IMAGE_MAX];
+    FILE *file = tmpfile();
+    CHECK(file && panel.writePng(file));
+    if (!file)
+    {
+        return;
+    }
+    size_t actualLen = ftell(file);
+    rewind(file);
+    actualLen = fread(actual, 1, actualLen < IMAGE_MAX ? actualLen : IMAGE_MAX, file);
+    fclose(file);
+
+    size_t expectedLen = readFile(goldenPath, expected, sizeof(expected));
+    if (actualLen != expectedLen || memcmp(actual, expected, actualLen) != 0)
+    {
+        fprintf(stderr, "%s differs from %s (missing golden? run make update-golden)\n", outputPath, goldenPath);
+        writeFrame(panel, outputPath);
+        CHECK(false);
+    }
+    else
+    {
+        remove(outputPath); // Left over from an earlier failing run.
+    }
+}
+
+// Nothing may be drawn into the left margin, whatever the text does.
+static void checkMargin(const Panel &panel)
+{
+    bool inked = false;
+    for (int16_t y = 0; y < Panel::HEIGHT; y++)
+    {
+        for (int16_t x = 0; x < TEXT_LEFT; x++)
+        {
+            inked = inked || panel.pixel(x, y);
+        }
+    }
+    CHECK(!inked);
+}
+
+int main(int argc, char **argv)
+{
+    update = argc > 1 && strcmp(argv[1], "--update") == 0;
+    buildSyntheticAtlas(atlas);
+    static Panel panel;
+    panel.setAtlas(&atlas);
+    panel.begin();
+
+    composeStatus(panel, "BEEPR ready", "Waiting for phone");
+    checkGolden(panel, "status");
+
+    composeNotification(panel, "Messages", "Alice", "See you at 7", 1, 0, 1, "now");
+    checkGolden(panel, "notification");
+    checkMargin(panel);
+
+    // Grouped app, a message wider than the panel, the counter on the right.
+    composeNotification(panel, "Mail", "Bob Appleseed", "Running late, see you at the station at seven!", 3, 4, 12,
+                        "59m");
+    checkGolden(panel, "notification_long");
+    checkMargin(panel);
+
+    // Header and message band redrawn in place over the screen above.
+    composeAge(panel, "2h");
+    checkGolden(panel, "age_update");
+    const char *message = "Running late, see you at the station at seven!";
+    size_t messageLen = strlen(message);
+    int16_t width = panel.textWidth(message) + 4 * GLYPH_ATLAS_WIDTH;
+    composeMessageBand(panel, message, messageLen, 37, width);
+    checkGolden(panel, "marquee_37");
+    composeMessageBand(panel, message, messageLen, width - 40, width);
+    checkGolden(panel, "marquee_wrap");
+    checkMargin(panel);
+
+    // Out-of-range index is clamped to the last entry.
+    composeNotification(panel, "Calendar", "", "", 1, 9, 2, "1d");
+    checkGolden(panel, "notification_clamped");
+
+    return checkResult("test_compose_golden");
+}
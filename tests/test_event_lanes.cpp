@@ -0,0 +1,137 @@
+// Removes in a full event lane: parked, never dropped while the park ring has
+// room, never waiting for the consumer, and never handed out ahead of an event
+// that entered the lane before them. Runs without PSRAM, so the lanes are
+// plain queues.
+
+#include "beepr_events.h"
+#include "beepr_flightrec.h"
+#include "beepr_notifs.h"
+#include "check.h"
+#include "fake_device.h"
+
+static const uint32_t ADD = 0x10000;
+static const uint32_t REMOVE = 0x20000;
+
+static bool addEvent(uint32_t uid)
+{
+    PendingNotifEvent event = {};
+    event.type = PendingEventAdd;
+    event.uid = uid;
+    event.category = CategoryIDSocial;
+    event.record = BeeprNotifs::claimRecord();
+    return BeeprEvents::enqueue(event);
+}
+
+static bool removeEvent(uint32_t uid)
+{
+    PendingNotifEvent event = {};
+    event.type = PendingEventRemove;
+    event.uid = uid;
+    event.category = CategoryIDSocial;
+    event.record = NOTIF_NO_RECORD;
+    return BeeprEvents::enqueue(event);
+}
+
+// Drains the lanes into out[] as ADD|uid or REMOVE|uid.
+static size_t drain(uint32_t *out, size_t size)
+{
+    size_t n = 0;
+    PendingNotifEvent event;
+    while (BeeprEvents::dequeue(event))
+    {
+        if (n < size)
+        {
+            out[n++] = (event.type == PendingEventAdd ? ADD : REMOVE) | event.uid;
+        }
+        BeeprNotifs::releaseRecord(event.record);
+    }
+    return n;
+}
+
+static size_t indexOf(const uint32_t *events, size_t count, uint32_t event)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (events[i] == event)
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+static EventLaneStats bulkStats()
+{
+    EventLaneStats stats;
+    BeeprEvents::laneCounters(EventLaneBulk, stats);
+    return stats;
+}
+
+int main()
+{
+    BeeprFlightRec::begin();
+    BeeprNotifs::begin();
+    BeeprEvents::begin();
+    const uint8_t depth = BeeprEvents::laneDepth(EventLaneBulk);
+    const uint16_t parkSize = NOTIF_STORE_CAPACITY + depth;
+    static uint32_t out[1024];
+
+    // A remove that finds the lane full waits for every add queued before it,
+    // including one that arrives later and evicts the oldest.
+    for (uint32_t i = 1; i <= depth; ++i)
+    {
+        CHECK(addEvent(i));
+    }
+    CHECK(removeEvent(2));
+    CHECK(addEvent(depth + 1));
+    size_t n = drain(out, 1024);
+    CHECK(n == (size_t)depth + 1);
+    CHECK(indexOf(out, n, ADD | 1) == n); // Evicted by DropOldest.
+    CHECK(indexOf(out, n, REMOVE | 2) == (size_t)depth - 1);
+    CHECK(indexOf(out, n, ADD | (depth + 1)) == n - 1);
+
+    // A queued remove that is later evicted keeps the place it entered with:
+    // it comes out first, not behind everything that arrived after it.
+    CHECK(addEvent(100));
+    CHECK(removeEvent(100));
+    for (uint32_t i = 0; i < depth; ++i)
+    {
+        CHECK(addEvent(200 + i));
+    }
+    n = drain(out, 1024);
+    CHECK(n == (size_t)depth + 1);
+    CHECK(n > 0 && out[0] == (REMOVE | 100));
+    CHECK(indexOf(out, n, ADD | 100) == n);
+
+    // A remove storm against a full lane neither blocks the producer nor
+    // overtakes the queued adds; beyond the park ring, removes are lost.
+    EventLaneStats before = bulkStats();
+    for (uint32_t i = 0; i < depth; ++i)
+    {
+        CHECK(addEvent(300 + i));
+    }
+    const uint16_t storm = parkSize + 10;
+    uint16_t accepted = 0;
+    for (uint32_t i = 0; i < storm; ++i)
+    {
+        accepted += removeEvent(300 + i);
+    }
+    CHECK(accepted == parkSize);
+    EventLaneStats after = bulkStats();
+    CHECK(after.removesLost - before.removesLost == 10);
+    CHECK(after.removesParked - before.removesParked == parkSize);
+    CHECK(BeeprEvents::pendingCount() == (uint32_t)depth + parkSize);
+    n = drain(out, 1024);
+    CHECK(n == (size_t)depth + parkSize);
+    for (uint32_t i = 0; i < depth; ++i)
+    {
+        CHECK(out[i] == (ADD | (300 + i)));
+    }
+    for (uint32_t i = 0; i < parkSize; ++i)
+    {
+        CHECK(out[depth + i] == (REMOVE | (300 + i)));
+    }
+    CHECK(BeeprEvents::pendingCount() == 0);
+
+    return checkResult("test_event_lanes");
+}
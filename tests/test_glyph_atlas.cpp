@@ -0,0 +1,190 @@
+// BeeprGlyphAtlas against a reference text renderer, pixel for pixel, at
+// every baseline and across both frame edges.
+//
+// With U8G2_DIR set (make U8G2_DIR=.../U8g2/src/clib) the reference is u8g2
+// itself: the atlas is captured from u8g2_font_6x12_tr as on the device and
+// compared with u8g2_DrawStr(). Without it the reference is a synthetic
+// fixed-width font drawn with u8g2's drawStr() rules (transparent, glyphs
+// outside the font skipped without advancing).
+
+#include "beepr_glyph_atlas.h"
+#include "check.h"
+
+#include <string.h>
+
+static const int16_t FRAME_WIDTH = 128;
+static const int16_t FRAME_PAGES = 8;
+static const int16_t FRAME_BYTES = FRAME_WIDTH * FRAME_PAGES;
+
+#ifdef BEEPR_TEST_U8G2
+#include "u8g2.h"
+
+static u8g2_t u8g2;
+// u8g2 coordinates are unsigned 8-bit: text cannot start left of the frame.
+static const int16_t MIN_X = 0;
+
+static void referenceBegin()
+{
+    u8g2_Setup_ssd1306_128x64_noname_f(&u8g2, U8G2_R0, u8x8_byte_empty, u8x8_dummy_cb);
+    u8g2_SetFont(&u8g2, u8g2_font_6x12_tr);
+    u8g2_SetFontMode(&u8g2, 1);
+}
+
+static void referenceGlyph(uint8_t *frame, char c, int16_t x)
+{
+    u8g2_ClearBuffer(&u8g2);
+    u8g2_DrawGlyph(&u8g2, (u8g2_uint_t)x, GLYPH_ATLAS_ASCENT, (uint8_t)c);
+    memcpy(frame, u8g2_GetBufferPtr(&u8g2), FRAME_BYTES);
+}
+
+static void referenceText(uint8_t *frame, int16_t x, int16_t baseline, const char *text)
+{
+    u8g2_ClearBuffer(&u8g2);
+    u8g2_DrawStr(&u8g2, (u8g2_uint_t)x, (u8g2_uint_t)baseline, text);
+    memcpy(frame, u8g2_GetBufferPtr(&u8g2), FRAME_BYTES);
+}
+
+static int16_t referenceWidth(const char *text)
+{
+    return (int16_t)u8g2_GetStrWidth(&u8g2, text);
+}
+
+#else
+static const int16_t MIN_X = -8;
+
+// Rows 0-13 of the glyph box, top at GLYPH_ATLAS_ASCENT above the baseline.
+static const int16_t FONT_ROWS = 14;
+
+static bool fontPixel(uint8_t c, int16_t col, int16_t row)
+{
+    return c != ' ' && (c + col * 3 + row * 5) % 7 == 0;
+}
+
+static void setPixel(uint8_t *frame, int16_t x, int16_t y)
+{
+    if (x >= 0 && x < FRAME_WIDTH && y >= 0 && y < FRAME_PAGES * 8)
+    {
+        frame[(y >> 3) * FRAME_WIDTH + x] |= (uint8_t)(1 << (y & 7));
+    }
+}
+
+static void referenceBegin()
+{
+}
+
+static void drawGlyph(uint8_t *frame, uint8_t c, int16_t x, int16_t baseline)
+{
+    for (int16_t col = 0; col < GLYPH_ATLAS_WIDTH; col++)
+    {
+        for (int16_t row = 0; row < FONT_ROWS; row++)
+        {
+            if (fontPixel(c, col, row))
+            {
+                setPixel(frame, x + col, baseline - GLYPH_ATLAS_ASCENT + row);
+            }
+        }
+    }
+}
+
+static void referenceGlyph(uint8_t *frame, char c, int16_t x)
+{
+    memset(frame, 0, FRAME_BYTES);
+    drawGlyph(frame, (uint8_t)c, x, GLYPH_ATLAS_ASCENT);
+}
+
+static bool inFont(uint8_t c)
+{
+    return c >= GLYPH_ATLAS_FIRST && c < GLYPH_ATLAS_FIRST + GLYPH_ATLAS_COUNT;
+}
+
+static void referenceText(uint8_t *frame, int16_t x, int16_t baseline, const char *text)
+{
+    memset(frame, 0, FRAME_BYTES);
+    for (; *text; text++)
+    {
+        uint8_t c = (uint8_t)*text;
+        if (!inFont(c))
+        {
+            continue;
+        }
+        drawGlyph(frame, c, x, baseline);
+        x += GLYPH_ATLAS_WIDTH;
+    }
+}
+
+static int16_t referenceWidth(const char *text)
+{
+    int16_t width = 0;
+    int16_t lastInk = 0;
+    for (; *text; text++)
+    {
+        uint8_t c = (uint8_t)*text;
+        if (!inFont(c))
+        {
+            continue;
+        }
+        lastInk = 0;
+        for (int16_t col = 0; col < GLYPH_ATLAS_WIDTH; col++)
+        {
+            for (int16_t row = 0; row < FONT_ROWS; row++)
+            {
+                if (fontPixel(c, col, row))
+                {
+                    lastInk = col + 1;
+                }
+            }
+        }
+        width += GLYPH_ATLAS_WIDTH;
+    }
+    return width > 0 ? width - GLYPH_ATLAS_WIDTH + lastInk : 0;
+}
+#endif
+
+static GlyphAtlas atlas;
+
+// As decodeGlyphs() does on the device: one glyph per frame at column 3.
+static void captureAtlas()
+{
+    static uint8_t frame[FRAME_BYTES];
+    memset(&atlas, 0, sizeof(atlas));
+    for (uint8_t i = 0; i < GLYPH_ATLAS_COUNT; i++)
+    {
+        char c = (char)(GLYPH_ATLAS_FIRST + i);
+        referenceGlyph(frame, c, 3);
+        BeeprGlyphAtlas::capture(atlas, c, frame, FRAME_WIDTH, 3);
+    }
+}
+
+static void compareText(const char *text)
+{
+    static uint8_t drawn[FRAME_BYTES];
+    static uint8_t expected[FRAME_BYTES];
+    int mismatches = 0;
+    for (int16_t baseline = -5; baseline < FRAME_PAGES * 8 + 16; baseline++)
+    {
+        for (int16_t x = MIN_X; x < FRAME_WIDTH + 2; x += 3)
+        {
+            memset(drawn, 0, sizeof(drawn));
+            BeeprGlyphAtlas::drawText(atlas, drawn, FRAME_WIDTH, FRAME_PAGES, x, baseline, text);
+            referenceText(expected, x, baseline, text);
+            if (memcmp(drawn, expected, sizeof(drawn)) != 0 && mismatches++ < 5)
+            {
+                fprintf(stderr, "\"%s\" differs at x=%d baseline=%d\n", text, x, baseline);
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(BeeprGlyphAtlas::textWidth(atlas, text) == referenceWidth(text));
+}
+
+int main()
+{
+    referenceBegin();
+    captureAtlas();
+    compareText("Hi there~");
+    compareText("Messages 12:45 | Mom");
+    compareText("A\x01 \x7f" "b");
+    compareText(" !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~");
+    CHECK(BeeprGlyphAtlas::textWidth(atlas, "") == 0);
+    return checkResult("test_glyph_atlas");
+}
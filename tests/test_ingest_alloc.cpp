@@ -0,0 +1,183 @@
+// Drives notifications through the ingest path the way beepr_ble.cpp does
+// (filter, record claim, event lanes, log, store, remove) and counts heap
+// allocations once it is warm. Steady-state ingest must not allocate.
+
+#include "beepr_events.h"
+#include "beepr_filter.h"
+#include "beepr_flightrec.h"
+#include "beepr_log.h"
+#include "beepr_notifs.h"
+#include "check.h"
+#include "fake_device.h"
+
+#include <malloc.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static bool countAllocs = false;
+static uint32_t allocs = 0;
+
+extern "C" void *malloc(size_t size)
+{
+    allocs += countAllocs;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    allocs += countAllocs;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocs += countAllocs;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+struct SampleNotification
+{
+    String bundleId;
+    String title;
+    String message;
+    NotificationCategory category;
+};
+
+static void copyToBuffer(const char *src, size_t srcLen, char *dst, size_t dstSize)
+{
+    size_t n = srcLen < dstSize - 1 ? srcLen : dstSize - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+// onNotificationArrived() and processPendingEvents() in beepr_ble.cpp.
+static void ingest(const SampleNotification &n, uint32_t uid)
+{
+    FilterVerdict verdict = BeeprFilter::evaluate(n.bundleId, n.category, n.title);
+    if (!verdict.allow)
+    {
+        return;
+    }
+    PendingNotifEvent event = {};
+    event.record = BeeprNotifs::claimRecord();
+    NotifRecord *rec = BeeprNotifs::record(event.record);
+    CHECK(rec != nullptr);
+    if (!rec)
+    {
+        return;
+    }
+    event.type = PendingEventAdd;
+    event.uid = uid;
+    event.category = n.category;
+    copyToBuffer(n.bundleId.c_str(), n.bundleId.length(), rec->app, sizeof(rec->app));
+    copyToBuffer(n.title.c_str(), n.title.length(), rec->title, sizeof(rec->title));
+    copyToBuffer(n.message.c_str(), n.message.length(), rec->message, sizeof(rec->message));
+    BeeprEvents::enqueue(event);
+
+    PendingNotifEvent out = {};
+    while (BeeprEvents::dequeue(out))
+    {
+        if (out.type == PendingEventAdd)
+        {
+            const NotifRecord *stored = BeeprNotifs::record(out.record);
+            BEEPR_LOGI("Notification received\n");
+            BEEPR_LOGI("App: %s\n", stored->app);
+            BEEPR_LOGI("Title: %s\n", stored->title);
+            BEEPR_LOGI("Message: %s\n", stored->message);
+            BEEPR_LOGI("UUID: %lu\n", (unsigned long)out.uid);
+            BeeprNotifs::add(out.record, out.uid, (uint8_t)out.category);
+        }
+        else
+        {
+            BEEPR_LOGI("Notification removed\n");
+            BEEPR_LOGI("UUID: %lu\n", (unsigned long)out.uid);
+            BeeprNotifs::removeByUid(out.uid);
+        }
+    }
+}
+
+static void removeEvent(uint32_t uid)
+{
+    PendingNotifEvent event = {};
+    event.type = PendingEventRemove;
+    event.record = NOTIF_NO_RECORD;
+    event.uid = uid;
+    BeeprEvents::enqueue(event);
+}
+
+int main()
+{
+    char longText[NOTIF_MESSAGE_LEN + 32];
+    memset(longText, 'm', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+
+    SampleNotification samples[] = {
+        {"com.apple.MobileSMS", "Alice with a rather long title that runs past the buffer", longText,
+         CategoryIDSocial},
+        {"com.example.unknown.app", "Build finished", "All 412 tests passed on main.", CategoryIDEmail},
+        {"com.apple.mobilephone", "Incoming call", "", CategoryIDIncomingCall},
+        {"com.cardify.tinder", "Dropped by an app rule", longText, CategoryIDSocial},
+        {"com.example.news", "Dropped by a category rule", longText, CategoryIDNews},
+    };
+    const size_t sampleCount = sizeof(samples) / sizeof(samples[0]);
+
+    BeeprFlightRec::begin();
+    BeeprNotifs::begin();
+    BeeprEvents::begin();
+    CHECK(BeeprFilter::loadRules("-app:com.cardify.tinder;-cat:news"));
+    // A set with a bad line is rejected whole; the rules above stay live.
+    CHECK(!BeeprFilter::loadRules("+app:com.cardify.tinder;-cat:nosuchcategory"));
+    CHECK(!BeeprFilter::evaluate(samples[3].bundleId, samples[3].category, samples[3].title).allow);
+
+    // The counting hook works: a long Print::printf line allocates.
+    countAllocs = true;
+    Serial.printf("%s\n", longText);
+    countAllocs = false;
+    CHECK(allocs == 1);
+
+    // Warm up: fill the store past capacity once so eviction paths have run.
+    uint32_t uid = 1;
+    for (size_t i = 0; i < NOTIF_STORE_CAPACITY + 4; i++)
+    {
+        ingest(samples[i % sampleCount], uid++);
+    }
+
+    allocs = 0;
+    countAllocs = true;
+    for (uint32_t round = 0; round < 500; round++)
+    {
+        Serial.capturedLen = 0;
+        ingest(samples[round % sampleCount], uid);
+        if (round % 3 == 0)
+        {
+            removeEvent(uid);
+            ingest(samples[1], uid + 1);
+        }
+        uid += 2;
+        hostAdvanceMs(250);
+        BeeprNotifs::update();
+    }
+    countAllocs = false;
+    CHECK(allocs == 0);
+    if (allocs)
+    {
+        fprintf(stderr, "ingest allocated %lu times\n", (unsigned long)allocs);
+    }
+
+    // Long lines still come out whole (up to LOG_LINE_MAX).
+    Serial.capturedLen = 0;
+    ingest(samples[0], uid++);
+    CHECK(strstr(Serial.captured, "Message: mmmm") != nullptr);
+    CHECK(strlen(Serial.captured) > NOTIF_MESSAGE_LEN);
+    CHECK(fakeDevice.renders > 0);
+
+    return checkResult("test_ingest_alloc");
+}
@@ -0,0 +1,91 @@
+// BeeprPowerState: the display timeout, button and notification wakes, the
+// always-on setting, residency, and all of it across the millis() wrap.
+
+#include "beepr_power_state.h"
+#include "check.h"
+
+static const uint32_t TIMEOUT_MS = 30000;
+
+static void timeout(uint32_t t0)
+{
+    PowerState s;
+    BeeprPowerState::reset(s, TIMEOUT_MS, t0);
+    CHECK(s.displayOn);
+    CHECK(BeeprPowerState::msUntilIdle(s, t0) == TIMEOUT_MS);
+
+    // Activity while on pushes the deadline out without counting as a wake.
+    CHECK(BeeprPowerState::onActivity(s, PowerWakeNotification, t0 + 10000) == PowerActionNone);
+    CHECK(s.activity[PowerWakeNotification] == 1);
+    CHECK(s.wakes[PowerWakeNotification] == 0);
+    CHECK(BeeprPowerState::msUntilIdle(s, t0 + 20000) == 20000);
+    CHECK(BeeprPowerState::onTick(s, t0 + 39999) == PowerActionNone);
+    CHECK(BeeprPowerState::onTick(s, t0 + 40000) == PowerActionDisplayOff);
+    CHECK(!s.displayOn);
+    CHECK(s.displaySleeps == 1);
+    // Off: no deadline, and further ticks change nothing.
+    CHECK(BeeprPowerState::msUntilIdle(s, t0 + 50000) == 0);
+    CHECK(BeeprPowerState::onTick(s, t0 + 90000) == PowerActionNone);
+    CHECK(s.displaySleeps == 1);
+
+    // A button wakes it and restarts the timeout.
+    CHECK(BeeprPowerState::onActivity(s, PowerWakeButton, t0 + 100000) == PowerActionDisplayOn);
+    CHECK(s.displayOn);
+    CHECK(s.wakes[PowerWakeButton] == 1);
+    CHECK(BeeprPowerState::msUntilIdle(s, t0 + 100000) == TIMEOUT_MS);
+    CHECK(BeeprPowerState::onActivity(s, PowerWakeButton, t0 + 101000) == PowerActionNone);
+    CHECK(s.activity[PowerWakeButton] == 2);
+    CHECK(s.wakes[PowerWakeButton] == 1);
+
+    // So does a notification.
+    CHECK(BeeprPowerState::onTick(s, t0 + 131000) == PowerActionDisplayOff);
+    CHECK(BeeprPowerState::onActivity(s, PowerWakeNotification, t0 + 140000) == PowerActionDisplayOn);
+    CHECK(s.wakes[PowerWakeNotification] == 1);
+    CHECK(s.displaySleeps == 2);
+
+    // On 0..40 s, off 40..100 s, on 100..131 s, off 131..140 s, on since.
+    uint32_t onMs = 0;
+    uint32_t offMs = 0;
+    BeeprPowerState::residency(s, t0 + 150000, onMs, offMs);
+    CHECK(onMs == 40000 + 31000 + 10000);
+    CHECK(offMs == 60000 + 9000);
+}
+
+static void alwaysOn()
+{
+    PowerState s;
+    BeeprPowerState::reset(s, 0, 1000);
+    CHECK(BeeprPowerState::msUntilIdle(s, 1000) == 0);
+    CHECK(BeeprPowerState::onTick(s, 0x7FFFFFFFUL) == PowerActionNone);
+    CHECK(BeeprPowerState::onActivity(s, PowerWakeButton, 0x80000000UL) == PowerActionNone);
+    CHECK(s.displayOn);
+    CHECK(s.displaySleeps == 0);
+    CHECK(s.wakes[PowerWakeButton] == 0);
+
+    uint32_t onMs = 0;
+    uint32_t offMs = 0;
+    BeeprPowerState::residency(s, 61000, onMs, offMs);
+    CHECK(onMs == 60000);
+    CHECK(offMs == 0);
+}
+
+// Unknown sources are ignored rather than indexing past the counters.
+static void badSource()
+{
+    PowerState s;
+    BeeprPowerState::reset(s, TIMEOUT_MS, 0);
+    BeeprPowerState::onTick(s, TIMEOUT_MS);
+    CHECK(BeeprPowerState::onActivity(s, PowerWakeSourceCount, TIMEOUT_MS + 1) == PowerActionNone);
+    CHECK(!s.displayOn);
+}
+
+int main()
+{
+    timeout(0);
+    timeout(5000);
+    // The timeout and residency straddle the millis() wrap.
+    timeout(0xFFFFFFFFUL - 35000);
+    timeout(0xFFFFFFFFUL - 120000);
+    alwaysOn();
+    badSource();
+    return checkResult("test_power_state");
+}
@@ -0,0 +1,248 @@
+// The record tiers on a board with PSRAM: new text lands in PSRAM, the
+// current and newest store entries are copied into the internal records, and the least recently used hot entry is evicted first.
+// Text must survive every move and no record may leak.
+
+#include "beepr_flightrec.h"
+#include "beepr_notifs.h"
+#include "check.h"
+#include "fake_device.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t UID_BASE = 0x1000;
+static const uint8_t ENTRIES = 20;
+// One internal record is kept spare for a view pinning an entry's old text.
+static const uint8_t HOT_ENTRIES = NOTIF_HOT_RECORDS - 1;
+
+static bool isInternal(uint16_t record)
+{
+    return record < NOTIF_HOT_RECORDS;
+}
+
+static void addEntry(uint8_t i)
+{
+    uint16_t index = BeeprNotifs::claimRecord();
+    NotifRecord *rec = BeeprNotifs::record(index);
+    CHECK(rec != nullptr);
+    if (!rec)
+    {
+        return;
+    }
+    CHECK(!isInternal(index));
+    snprintf(rec->app, sizeof(rec->app), "app%u", (unsigned)(i % 3));
+    snprintf(rec->title, sizeof(rec->title), "title %u", (unsigned)i);
+    snprintf(rec->message, sizeof(rec->message), "message %u", (unsigned)i);
+    BeeprNotifs::add(index, UID_BASE + i, 0);
+}
+
+static void editEntry(uint8_t i, unsigned edit)
+{
+    uint16_t index = BeeprNotifs::claimRecord();
+    NotifRecord *rec = BeeprNotifs::record(index);
+    CHECK(rec != nullptr);
+    if (!rec)
+    {
+        return;
+    }
+    snprintf(rec->app, sizeof(rec->app), "app%u", (unsigned)(i % 3));
+    snprintf(rec->title, sizeof(rec->title), "title %u", (unsigned)i);
+    snprintf(rec->message, sizeof(rec->message), "edit %u", edit);
+    BeeprNotifs::add(index, UID_BASE + i, 0);
+}
+
+// Reference cache: uid offsets, most recently used first. A touch moves an
+// entry to the front, evicting the last one once the cache is full.
+static void touchModel(uint32_t *model, uint8_t &count, uint32_t entry)
+{
+    uint8_t at = count;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        if (model[i] == entry)
+        {
+            at = i;
+        }
+    }
+    if (at == count && count < HOT_ENTRIES)
+    {
+        count++;
+    }
+    else if (at == count)
+    {
+        at = count - 1;
+    }
+    for (; at > 0; --at)
+    {
+        model[at] = model[at - 1];
+    }
+    model[0] = entry;
+}
+
+static void dropModel(uint32_t *model, uint8_t &count, uint32_t present)
+{
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        if (present & (1UL << model[i]))
+        {
+            model[kept++] = model[i];
+        }
+    }
+    count = kept;
+}
+
+// Which entries (by uid offset) hold internal records; text checked on the way.
+static uint32_t hotEntries()
+{
+    uint32_t hot = 0;
+    NotifEntry entry;
+    for (size_t i = 0; BeeprNotifs::retainEntry(i, entry); ++i)
+    {
+        const NotifRecord *rec = BeeprNotifs::record(entry.record);
+        unsigned n = (unsigned)(entry.uid - UID_BASE);
+        char title[16];
+        snprintf(title, sizeof(title), "title %u", n);
+        CHECK(rec && strcmp(rec->title, title) == 0);
+        if (isInternal(entry.record))
+        {
+            hot |= 1UL << n;
+        }
+        BeeprNotifs::releaseRecord(entry.record);
+    }
+    return hot;
+}
+
+static bool currentIsInternal()
+{
+    const NotifView *view = BeeprNotifs::acquireView();
+    bool internal = view && view->hasNotification && isInternal(view->record);
+    BeeprNotifs::releaseView(view);
+    return internal;
+}
+
+static uint32_t bits(uint8_t first, uint8_t last)
+{
+    uint32_t mask = 0;
+    for (uint8_t i = first; i <= last; ++i)
+    {
+        mask |= 1UL << i;
+    }
+    return mask;
+}
+
+int main()
+{
+    hostPsram = true;
+    BeeprFlightRec::begin();
+    BeeprNotifs::begin();
+    uint16_t total = NOTIF_RECORD_POOL_SIZE + EVENT_BACKLOG_HIGH + EVENT_BACKLOG_BULK;
+    CHECK(BeeprNotifs::slowRecordCapacity() == total - NOTIF_HOT_RECORDS);
+
+    // Each add makes the new entry newest and current: the hot set is the
+    // last HOT_ENTRIES added.
+    for (uint8_t i = 0; i < ENTRIES; ++i)
+    {
+        addEntry(i);
+        CHECK(currentIsInternal());
+    }
+    CHECK(hotEntries() == bits(ENTRIES - HOT_ENTRIES, ENTRIES - 1));
+
+    // Against a reference LRU cache under random paging, app jumps, edits
+    // and removes: every publish touches the newest entry, then the current
+    // one, and a removed entry leaves the cache.
+    uint32_t model[HOT_ENTRIES];
+    uint8_t modelCount = 0;
+    for (uint8_t i = 0; i < HOT_ENTRIES; ++i)
+    {
+        model[modelCount++] = ENTRIES - 1 - i;
+    }
+    uint32_t present = bits(0, ENTRIES - 1);
+    srand(12345);
+    for (int op = 0; op < 2000; ++op)
+    {
+        uint8_t pick = (uint8_t)(rand() % ENTRIES);
+        int kind = rand() % 20;
+        // Mostly paging and edits, so the cache stays full and evicts.
+        if (kind < 8)
+        {
+            BeeprNotifs::next();
+        }
+        else if (kind < 12)
+        {
+            BeeprNotifs::nextApp();
+        }
+        else if (kind < 18)
+        {
+            // New or edited text, taken over as the current entry.
+            editEntry(pick, (unsigned)op);
+            present |= 1UL << pick;
+        }
+        else if (kind < 19)
+        {
+            if (BeeprNotifs::removeByUid(UID_BASE + pick))
+            {
+                present &= ~(1UL << pick);
+            }
+        }
+        else
+        {
+            BeeprNotifs::removeCurrent();
+            present = 0;
+            NotifEntry entry;
+            for (size_t i = 0; BeeprNotifs::retainEntry(i, entry); ++i)
+            {
+                present |= 1UL << (entry.uid - UID_BASE);
+                BeeprNotifs::releaseRecord(entry.record);
+            }
+        }
+
+        dropModel(model, modelCount, present);
+        const NotifView *view = BeeprNotifs::acquireView();
+        if (view && view->hasNotification)
+        {
+            touchModel(model, modelCount, view->uids[view->total - 1] - UID_BASE);
+            touchModel(model, modelCount, view->uid - UID_BASE);
+            CHECK(isInternal(view->record));
+        }
+        BeeprNotifs::releaseView(view);
+
+        uint32_t expected = 0;
+        for (uint8_t i = 0; i < modelCount; ++i)
+        {
+            expected |= 1UL << model[i];
+        }
+        uint32_t actual = hotEntries();
+        if (actual != expected)
+        {
+            fprintf(stderr, "op %d: hot %08lx, expected %08lx\n", op, (unsigned long)actual,
+                    (unsigned long)expected);
+            CHECK(false);
+            break;
+        }
+    }
+
+    // Emptying the store returns every record: all of them can be claimed.
+    while (BeeprNotifs::removeAt(0))
+    {
+    }
+    CHECK(hotEntries() == 0);
+    uint16_t claimed = 0;
+    uint16_t internal = 0;
+    static uint16_t held[NOTIF_RECORD_POOL_SIZE + EVENT_BACKLOG_HIGH + EVENT_BACKLOG_BULK];
+    for (uint16_t r = BeeprNotifs::claimRecord(); r != NOTIF_NO_RECORD; r = BeeprNotifs::claimRecord())
+    {
+        internal += isInternal(r);
+        // PSRAM is handed out before the internal tier is touched.
+        CHECK(isInternal(r) == (claimed >= total - NOTIF_HOT_RECORDS));
+        held[claimed++] = r;
+    }
+    CHECK(claimed == total);
+    CHECK(internal == NOTIF_HOT_RECORDS);
+    for (uint16_t i = 0; i < claimed; ++i)
+    {
+        BeeprNotifs::releaseRecord(held[i]);
+    }
+
+    return checkResult("test_record_tiers");
+}
@@ -0,0 +1,170 @@
+// BeeprTtlWheel against a naive reference (one absolute deadline per timer)
+// under random arm/cancel/advance sequences that cross the millis() wrap,
+// plus the cost of catching up after a long idle stretch.
+
+#include "beepr_ttl_wheel.h"
+#include "check.h"
+
+#include <stdlib.h>
+
+static const int64_t NOT_ARMED = -1;
+
+static void fuzz(unsigned seed)
+{
+    srand(seed);
+    TtlWheel wheel;
+    uint32_t nowMs = 0xFFFF0000UL + seed * 7777; // Wraps within the first minute.
+    int64_t elapsedMs = 0;                       // Reference time, never wraps.
+    int64_t dueMs[TTL_WHEEL_TIMERS];
+    for (uint8_t i = 0; i < TTL_WHEEL_TIMERS; i++)
+    {
+        dueMs[i] = NOT_ARMED;
+    }
+    BeeprTtlWheel::reset(wheel, nowMs);
+
+    for (int op = 0; op < 4000; op++)
+    {
+        int kind = rand() % 10;
+        uint8_t id = (uint8_t)(rand() % TTL_WHEEL_TIMERS);
+        if (kind < 3)
+        {
+            // Mostly within the wheel, sometimes far beyond its horizon.
+            uint32_t delayMs = rand() % 4 == 0 ? (uint32_t)rand() % 300000000UL : (uint32_t)rand() % 200000;
+            BeeprTtlWheel::arm(wheel, id, delayMs, nowMs);
+            dueMs[id] = elapsedMs + delayMs;
+            continue;
+        }
+        if (kind < 4)
+        {
+            BeeprTtlWheel::cancel(wheel, id);
+            dueMs[id] = NOT_ARMED;
+            continue;
+        }
+
+        // Either jump straight to the next deadline, as the timer task does,
+        // or let an arbitrary time pass.
+        uint32_t nextMs = BeeprTtlWheel::msUntilNext(wheel, nowMs);
+        uint32_t stepMs = rand() % 3 == 0 && nextMs != TTL_NO_DEADLINE
+                              ? nextMs
+                              : (uint32_t)rand() % (rand() % 2 ? 5000 : 20000000);
+        nowMs += stepMs;
+        elapsedMs += stepMs;
+
+        uint8_t fired[TTL_WHEEL_TIMERS];
+        uint8_t count = BeeprTtlWheel::advance(wheel, nowMs, fired);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            int64_t due = dueMs[fired[i]];
+            CHECK(due != NOT_ARMED);
+            CHECK(due <= elapsedMs);
+            // Late by at most the time just skipped plus tick rounding.
+            CHECK(elapsedMs - due < (int64_t)stepMs + 2 * TTL_TICK_MS);
+            dueMs[fired[i]] = NOT_ARMED;
+        }
+
+        int64_t earliest = NOT_ARMED;
+        for (uint8_t i = 0; i < TTL_WHEEL_TIMERS; i++)
+        {
+            if (dueMs[i] == NOT_ARMED)
+            {
+                CHECK(!BeeprTtlWheel::armed(wheel, i));
+                continue;
+            }
+            CHECK(BeeprTtlWheel::armed(wheel, i));
+            CHECK(dueMs[i] > elapsedMs - (int64_t)TTL_TICK_MS);
+            if (earliest == NOT_ARMED || dueMs[i] < earliest)
+            {
+                earliest = dueMs[i];
+            }
+        }
+
+        // The deadline is never later than the earliest timer (plus a tick).
+        nextMs = BeeprTtlWheel::msUntilNext(wheel, nowMs);
+        if (earliest == NOT_ARMED)
+        {
+            CHECK(nextMs == TTL_NO_DEADLINE);
+        }
+        else
+        {
+            CHECK((int64_t)nextMs <= earliest - elapsedMs + (int64_t)TTL_TICK_MS);
+        }
+    }
+}
+
+// A timer armed after days with nothing armed counts from now, and firing it
+// steps the wheel once instead of once per idle tick.
+static void idleCatchUp()
+{
+    TtlWheel wheel;
+    uint32_t nowMs = 1000;
+    BeeprTtlWheel::reset(wheel, nowMs);
+    nowMs += 10UL * 24 * 3600 * 1000;
+
+    BeeprTtlWheel::arm(wheel, 0, 5000, nowMs);
+    uint32_t nextMs = BeeprTtlWheel::msUntilNext(wheel, nowMs);
+    CHECK(nextMs >= 5000 && nextMs <= 5000 + TTL_TICK_MS);
+
+    uint8_t fired[TTL_WHEEL_TIMERS];
+    CHECK(BeeprTtlWheel::advance(wheel, nowMs + nextMs, fired) == 1);
+    CHECK(fired[0] == 0);
+    CHECK(wheel.steps == 1);
+}
+
+// With a far timer armed, a long gap with no events in it is skipped too:
+// the steps taken are the cascades and the firing, not the elapsed ticks.
+static void sparseAdvance()
+{
+    TtlWheel wheel;
+    uint32_t nowMs = 0;
+    BeeprTtlWheel::reset(wheel, nowMs);
+    BeeprTtlWheel::arm(wheel, 7, 48UL * 3600 * 1000, nowMs);
+
+    uint8_t fired[TTL_WHEEL_TIMERS];
+    nowMs += 50UL * 3600 * 1000;
+    CHECK(BeeprTtlWheel::advance(wheel, nowMs, fired) == 1);
+    CHECK(fired[0] == 7);
+    CHECK(wheel.steps <= TTL_WHEEL_LEVELS);
+    CHECK(BeeprTtlWheel::msUntilNext(wheel, nowMs) == TTL_NO_DEADLINE);
+}
+
+// Waking only at msUntilNext() fires a one-hour timer on time in a handful
+// of wakes.
+static void deadlineWakes()
+{
+    TtlWheel wheel;
+    BeeprTtlWheel::reset(wheel, 0);
+    BeeprTtlWheel::arm(wheel, 3, 3600000UL, 0);
+
+    uint32_t nowMs = 0;
+    int wakes = 0;
+    uint8_t fired[TTL_WHEEL_TIMERS];
+    for (;;)
+    {
+        uint32_t nextMs = BeeprTtlWheel::msUntilNext(wheel, nowMs);
+        CHECK(nextMs != TTL_NO_DEADLINE);
+        if (nextMs == TTL_NO_DEADLINE)
+        {
+            break;
+        }
+        nowMs += nextMs;
+        wakes++;
+        if (BeeprTtlWheel::advance(wheel, nowMs, fired))
+        {
+            break;
+        }
+    }
+    CHECK(nowMs >= 3600000UL && nowMs <= 3600000UL + TTL_TICK_MS);
+    CHECK(wakes <= 2 * TTL_WHEEL_LEVELS);
+}
+
+int main()
+{
+    for (unsigned seed = 0; seed < 200; seed++)
+    {
+        fuzz(seed);
+    }
+    idleCatchUp();
+    sparseAdvance();
+    deadlineWakes();
+    return checkResult("test_ttl_wheel");
+}
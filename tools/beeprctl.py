@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""Drive the Beepr binary serial protocol (see beepr_proto.h).
+
+Examples:
+    beeprctl.py -p /dev/ttyUSB0 ping
+    beeprctl.py -p /dev/ttyUSB0 inject --count 200 --batch 4 --category 4
+    beeprctl.py -p /dev/ttyUSB0 burst --count 500 --category mixed
+    beeprctl.py -p /dev/ttyUSB0 dump
+    beeprctl.py -p /dev/ttyUSB0 counters
+
+Requires pyserial. Text log lines the firmware prints between frames are
+ignored, or echoed with --verbose.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+try:
+    import serial
+except ImportError:
+    sys.exit("beeprctl needs pyserial: pip install pyserial")
+
+MSG_PING = 0x01
+MSG_INJECT = 0x02
+MSG_BURST = 0x03
+MSG_DUMP = 0x04
+MSG_READ_COUNTERS = 0x05
+MSG_PONG = 0x81
+MSG_INJECT_ACK = 0x82
+MSG_DUMP_ENTRY = 0x84
+MSG_DUMP_END = 0x85
+MSG_COUNTERS = 0x86
+MSG_ERROR = 0xFF
+
+OP_ADD = 0
+OP_REMOVE = 1
+BURST_MIXED = 0xFF
+
+CATEGORIES = [
+    "other", "incomingcall", "missedcall", "voicemail", "social", "schedule",
+    "email", "news", "healthandfitness", "businessandfinance", "location",
+    "entertainment",
+]
+LANES = ["urgent", "high", "bulk"]
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(byte)
+        code += 1
+        if code == 0xFF:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def pack_str(text):
+    raw = text.encode("utf-8")[:255]
+    return bytes([len(raw)]) + raw
+
+
+class Link:
+    def __init__(self, port, baud, verbose):
+        self.ser = serial.Serial(port, baud, timeout=0.05)
+        self.verbose = verbose
+        self.seq = 0
+        self.pending = bytearray()
+        # A lone delimiter switches the console into binary mode.
+        self.ser.write(b"\x00")
+
+    def send(self, msg_type, payload=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        body = bytes([msg_type, self.seq]) + payload
+        frame = body + struct.pack("<H", crc16(body))
+        self.ser.write(b"\x00" + cobs_encode(frame) + b"\x00")
+        return self.seq
+
+    def frames(self, timeout):
+        """Yields (type, seq, payload) until `timeout` passes without a frame."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            chunk = self.ser.read(4096)
+            if not chunk:
+                continue
+            self.pending += chunk
+            while b"\x00" in self.pending:
+                raw, _, rest = self.pending.partition(b"\x00")
+                self.pending = bytearray(rest)
+                frame = cobs_decode(bytes(raw)) if raw else None
+                if (frame is None or len(frame) < 4
+                        or crc16(frame[:-2]) != struct.unpack("<H", frame[-2:])[0]):
+                    # Log text or a damaged frame.
+                    if raw and self.verbose:
+                        sys.stderr.write(raw.decode("utf-8", "replace"))
+                    continue
+                deadline = time.monotonic() + timeout
+                yield frame[0], frame[1], frame[2:-2]
+
+    def request(self, msg_type, payload=b"", timeout=1.0):
+        seq = self.send(msg_type, payload)
+        for reply_type, reply_seq, body in self.frames(timeout):
+            if reply_seq == seq:
+                return reply_type, body
+        raise TimeoutError("no reply to message 0x%02x" % msg_type)
+
+
+def parse_category(text):
+    if text == "mixed":
+        return BURST_MIXED
+    if text.isdigit():
+        return int(text)
+    return CATEGORIES.index(text.lower())
+
+
+def check_error(reply_type, body):
+    if reply_type == MSG_ERROR:
+        sys.exit("device error %d" % body[0])
+
+
+def cmd_ping(link, args):
+    start = time.monotonic()
+    reply_type, body = link.request(MSG_PING)
+    check_error(reply_type, body)
+    version, uptime = struct.unpack("<BI", body[:5])
+    print("protocol v%d, uptime %.1fs, rtt %.1fms"
+          % (version, uptime / 1000.0, (time.monotonic() - start) * 1000.0))
+
+
+def cmd_inject(link, args):
+    category = parse_category(args.category)
+    sent = 0
+    seqs = {}
+    start = time.monotonic()
+    while sent < args.count:
+        items = bytearray()
+        for i in range(min(args.batch, args.count - sent)):
+            uid = args.base_uid + sent + i
+            cat = (uid % len(CATEGORIES)) if category == BURST_MIXED else category
+            items += struct.pack("<BIB", OP_ADD, uid, cat)
+            items += pack_str(args.app)
+            items += pack_str("%s %d" % (args.title, uid))
+            items += pack_str(args.message)
+        seqs[link.send(MSG_INJECT, bytes(items))] = True
+        sent += min(args.batch, args.count - sent)
+        if args.rate:
+            time.sleep(args.batch / float(args.rate))
+    elapsed = time.monotonic() - start
+
+    accepted = rejected = 0
+    for reply_type, seq, body in link.frames(1.0):
+        if reply_type == MSG_INJECT_ACK and seqs.pop(seq, False):
+            a, r = struct.unpack("<HH", body[:4])
+            accepted += a
+            rejected += r
+            if not seqs:
+                break
+    print("sent %d in %.3fs (%.0f/s): accepted %d rejected %d, %d acks missing"
+          % (args.count, elapsed, args.count / max(elapsed, 1e-6), accepted, rejected, len(seqs)))
+
+
+def cmd_burst(link, args):
+    payload = struct.pack("<HIB", args.count, args.base_uid, parse_category(args.category))
+    reply_type, body = link.request(MSG_BURST, payload, timeout=5.0)
+    check_error(reply_type, body)
+    accepted, rejected = struct.unpack("<HH", body[:4])
+    print("burst of %d: accepted %d rejected %d" % (args.count, accepted, rejected))
+
+
+def cmd_dump(link, args):
+    seq = link.send(MSG_DUMP)
+    for reply_type, reply_seq, body in link.frames(1.0):
+        if reply_seq != seq:
+            continue
+        if reply_type == MSG_DUMP_END:
+            print("%d entries" % body[0])
+            return
+        index, total, uid, category = struct.unpack("<BBIB", body[:7])
+        fields = []
+        pos = 7
+        for _ in range(3):
+            n = body[pos]
+            fields.append(body[pos + 1:pos + 1 + n].decode("utf-8", "replace"))
+            pos += 1 + n
+        name = CATEGORIES[category] if category < len(CATEGORIES) else str(category)
+        print("%2d/%d uid=%08x %-12s %s | %s | %s" % (index + 1, total, uid, name, *fields))
+    sys.exit("dump did not finish")
+
+
+def cmd_counters(link, args):
+    reply_type, body = link.request(MSG_READ_COUNTERS)
+    check_error(reply_type, body)
+    uptime, lanes = struct.unpack_from("<IB", body, 0)
+    pos = 5
+    print("uptime %.1fs" % (uptime / 1000.0))
+    for lane in range(lanes):
+        enq, drop, deq, hw, lat_max, lat_avg = struct.unpack_from("<6I", body, pos)
+        pos += 24
+        name = LANES[lane] if lane < len(LANES) else str(lane)
+        print("  %-6s in=%d out=%d drop=%d hw=%d lat avg=%dus max=%dus"
+              % (name, enq, deq, drop, hw, lat_avg, lat_max))
+    store, dups, heap_free, heap_min = struct.unpack_from("<HIII", body, pos)
+    pos += 14
+    rx, crc_err, framing, injected, rejected = struct.unpack_from("<5I", body, pos)
+    pos += 20
+    for lane in range(lanes):
+        if pos + 8 > len(body):
+            break
+        spilled, backlog_hw = struct.unpack_from("<2I", body, pos)
+        pos += 8
+        if spilled or backlog_hw:
+            name = LANES[lane] if lane < len(LANES) else str(lane)
+            print("  %-6s backlog spilled=%d hw=%d" % (name, spilled, backlog_hw))
+    print("store %d entries, %d duplicate updates" % (store, dups))
+    print("heap free %d min %d" % (heap_free, heap_min))
+    print("link rx=%d crc errors=%d framing errors=%d injected=%d rejected=%d"
+          % (rx, crc_err, framing, injected, rejected))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-p", "--port", required=True)
+    parser.add_argument("-b", "--baud", type=int, default=115200)
+    parser.add_argument("-v", "--verbose", action="store_true", help="echo device log text")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    sub.add_parser("ping")
+    inject = sub.add_parser("inject", help="stream notifications over the link")
+    inject.add_argument("--count", type=int, default=100)
+    inject.add_argument("--batch", type=int, default=4, help="items per frame")
+    inject.add_argument("--rate", type=float, default=0, help="items/s, 0 = line rate")
+    inject.add_argument("--category", default="social", help="name, number or 'mixed'")
+    inject.add_argument("--base-uid", type=lambda v: int(v, 0), default=0xE0000000)
+    inject.add_argument("--app", default="Host")
+    inject.add_argument("--title", default="Inject")
+    inject.add_argument("--message", default="Injected by beeprctl")
+    burst = sub.add_parser("burst", help="have the device synthesize notifications")
+    burst.add_argument("--count", type=int, default=100)
+    burst.add_argument("--category", default="mixed")
+    burst.add_argument("--base-uid", type=lambda v: int(v, 0), default=0xD0000000)
+    sub.add_parser("dump")
+    sub.add_parser("counters")
+
+    args = parser.parse_args()
+    link = Link(args.port, args.baud, args.verbose)
+    handlers = {
+        "ping": cmd_ping,
+        "inject": cmd_inject,
+        "burst": cmd_burst,
+        "dump": cmd_dump,
+        "counters": cmd_counters,
+    }
+    handlers[args.command](link, args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Decode Beepr flight recorder dumps (see beepr_flightrec.h) into a timeline.
+
+Reads a serial log from a file or stdin and decodes every "FR BEGIN" ...
+"FR END" block in it: the dump printed at boot after a reset, or the one
+printed by the `flight` console command.
+
+Examples:
+    flightrec_decode.py boot.log
+    pio device monitor | tee boot.log   # then decode the file
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+RESET_REASONS = {
+    0: "unknown", 1: "power-on", 2: "external", 3: "software", 4: "panic",
+    5: "interrupt watchdog", 6: "task watchdog", 7: "other watchdog",
+    8: "deep sleep", 9: "brownout", 10: "SDIO",
+}
+LANES = ["urgent", "high", "bulk"]
+
+
+def lane(n):
+    return LANES[n] if n < len(LANES) else str(n)
+
+
+EVENTS = {
+    1: ("boot", lambda a8, a16: "boot %d, reset reason %s" % (a16, RESET_REASONS.get(a8, a8))),
+    2: ("enqueue", lambda a8, a16: "lane %s depth %d" % (lane(a8), a16)),
+    3: ("drop", lambda a8, a16: "lane %s, %d dropped so far" % (lane(a8), a16)),
+    4: ("store+", lambda a8, a16: "store size %d" % a16),
+    5: ("store-", lambda a8, a16: "store size %d%s" % (a16, ", expired" if a8 else "")),
+    6: ("render", lambda a8, a16: "%s, compose %dus" % ("notification" if a8 else "status", a16)),
+    7: ("heap", lambda a8, a16: "new low-water mark %d KB free" % a16),
+    8: ("connect", lambda a8, a16: ""),
+    9: ("disconnect", lambda a8, a16: ""),
+    10: ("encrypted", lambda a8, a16: "ok" if a8 else "FAILED"),
+    11: ("first-notif", lambda a8, a16: "%dms after connect" % a16),
+}
+
+BEGIN = re.compile(r"FR BEGIN v(\d+) boot=(\d+) reason=(\d+) records=(\d+) tick_ms=(\d+)")
+LINE = re.compile(r"FR ([0-9a-f]{4}) ([0-9a-f]+)")
+
+
+def decode_block(header, data, out):
+    version, boot, reason, records, tick_ms = (int(v) for v in header.groups())
+    if version != 1:
+        out.write("unsupported dump version %d\n" % version)
+        return
+    out.write("== dump after boot %d, reset reason %s, %d slots ==\n"
+              % (boot, RESET_REASONS.get(reason, reason), records))
+    for offset in range(0, len(data) - 7, 8):
+        tick, packed = struct.unpack_from("<II", data, offset)
+        event = packed & 0xFF
+        if event == 0:
+            continue
+        a8 = (packed >> 8) & 0xFF
+        a16 = packed >> 16
+        if event == 1:
+            out.write("\n")
+        name, describe = EVENTS.get(event, ("event %d" % event, lambda a, b: "%d %d" % (a, b)))
+        seconds = tick * tick_ms / 1000.0
+        line = "%10.3fs  %-12s %s" % (seconds, name, describe(a8, a16))
+        out.write(line.rstrip() + "\n")
+    out.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    args = parser.parse_args()
+
+    source = open(args.log, errors="replace") if args.log else sys.stdin
+    header = None
+    data = bytearray()
+    blocks = 0
+    for raw in source:
+        text = raw.strip()
+        match = BEGIN.search(text)
+        if match:
+            header, data = match, bytearray()
+            continue
+        if header is None:
+            continue
+        if text.endswith("FR END"):
+            decode_block(header, bytes(data), sys.stdout)
+            header = None
+            blocks += 1
+            continue
+        match = LINE.search(text)
+        if match:
+            data += bytes.fromhex(match.group(2))
+    if blocks == 0:
+        sys.exit("no flight recorder dump found")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds every preset with arduino-cli and prints its flash and static RAM use.
+# usage: tools/footprint.sh [fqbn]    (default esp32:esp32:esp32)
+set -e
+FQBN=${1:-esp32:esp32:esp32}
+SKETCH=$(cd "$(dirname "$0")/.." && pwd)
+
+printf '%-10s %12s %12s\n' preset flash ram
+for preset in 0:full 1:headless 2:minimal; do
+    id=${preset%%:*}
+    name=${preset#*:}
+    out=$(arduino-cli compile --fqbn "$FQBN" \
+        --build-path "$SKETCH/build/$name" \
+        --build-property "compiler.cpp.extra_flags=-DBEEPR_PRESET=$id" \
+        "$SKETCH" 2>&1) || { echo "$out"; exit 1; }
+    flash=$(echo "$out" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+    ram=$(echo "$out" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+    printf '%-10s %12s %12s\n' "$name" "$flash" "$ram"
+done